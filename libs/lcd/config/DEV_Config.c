@@ -41,13 +41,8 @@ note:		Initialize the communication method
 void System_Init(void)
 {
 	DEV_GPIO_Init();
-#if PICO_RP2040
-	spi_init(SPI_PORT, 125 * 1000 * 1000 / 3); /* 41.6666 MHz */
-	//spi_init(SPI_PORT, 200 * 1000 * 1000 / 5); /* 40.00 MHz */
-#endif
-#if PICO_RP2350
-	spi_init(SPI_PORT, 150 * 1000 * 1000 / 5); /* 30.00 MHz */
-#endif
+	/* 31.25 MHz at 125 MHz, 25 MHz at 150 MHz, 31.25 MHz at 250 MHz */
+	spi_init(SPI_PORT, LCD_SPI_BAUD);
 	gpio_set_function(LCD_CLK_PIN, GPIO_FUNC_SPI);
 	gpio_set_function(LCD_MOSI_PIN, GPIO_FUNC_SPI);
 	gpio_set_function(LCD_MISO_PIN, GPIO_FUNC_SPI);
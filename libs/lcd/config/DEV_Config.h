@@ -30,6 +30,8 @@
 #define TP_IRQ_PIN	17
 
 #define SPI_PORT	spi1
+/* max. SPI clock of the LCD, the dividers are computed from clk_peri */
+#define LCD_SPI_BAUD	(32 * 1000 * 1000)
 
 static inline void DEV_Digital_Write(UWORD Pin, UBYTE Value)
 {
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 Thomas Eberhardt
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _MSC_CACHE_H
+#define _MSC_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hw_config.h"
+
+/** \brief Readahead and write gathering between the MSC callbacks and the SD card
+ *
+ *  The MSC callbacks only copy data from and to RAM buffers when possible. The SD card
+ *  is read ahead and the gathered writes are written by msc_cache_task(), which runs after
+ *  tud_task() returned, while the USB controller transfers the next packets.
+ *  Written data is kept until msc_cache_task() or msc_cache_flush() ran, at most
+ *  STDIO_MSC_USB_WRITE_DELAY_US after the last write while the task runs.
+ */
+
+// PICO_CONFIG: STDIO_MSC_USB_READAHEAD_BLOCKS, Number of 512 byte blocks read ahead after a READ10 callback, 0 disables readahead, default=8, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_READAHEAD_BLOCKS
+#define STDIO_MSC_USB_READAHEAD_BLOCKS 8
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_WRITE_BLOCKS, Number of 512 byte blocks of contiguous WRITE10 data gathered before they are written, 0 writes immediately, default=16, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_WRITE_BLOCKS
+#define STDIO_MSC_USB_WRITE_BLOCKS 16
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_WRITE_DELAY_US, Number of microseconds after the last WRITE10 callback until gathered blocks are written, default=10000, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_WRITE_DELAY_US
+#define STDIO_MSC_USB_WRITE_DELAY_US 10000
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t sd_reads;      ///< read commands sent to the SD card
+    uint32_t sd_writes;     ///< write commands sent to the SD card
+    uint32_t ra_hits;       ///< READ10 callbacks served from the readahead buffer
+    uint32_t wr_gathered;   ///< WRITE10 callbacks appended to the write buffer
+} msc_cache_stats_t;
+
+extern msc_cache_stats_t msc_cache_stats;
+
+int32_t msc_cache_read(sd_card_t *sd_card_p, uint32_t lba, uint8_t *buffer, uint32_t blockcnt);
+int32_t msc_cache_write(sd_card_t *sd_card_p, uint32_t lba, const uint8_t *buffer, uint32_t blockcnt);
+bool msc_cache_flush(sd_card_t *sd_card_p);
+void msc_cache_task(sd_card_t *sd_card_p, bool readahead);
+void msc_cache_invalidate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
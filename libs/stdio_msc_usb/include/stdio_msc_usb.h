@@ -37,6 +37,44 @@
 #define STDIO_MSC_USB_TASK_INTERVAL_US 1000
 #endif
 
+// PICO_CONFIG: STDIO_MSC_USB_HIGH_THROUGHPUT, Buffer USB output in larger CDC FIFOs and send it when a packet is full or after STDIO_MSC_USB_FLUSH_IDLE_US without output, instead of flushing and running tud_task() on every write, type=bool, default=0, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_HIGH_THROUGHPUT
+#define STDIO_MSC_USB_HIGH_THROUGHPUT 0
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_FLUSH_IDLE_US, Number of microseconds without output after which a partial packet is sent in high throughput mode, default=1000, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_FLUSH_IDLE_US
+#define STDIO_MSC_USB_FLUSH_IDLE_US 1000
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_CDC_RX_BUFSIZE, Size of the CDC receive FIFO, default=256 (1024 with STDIO_MSC_USB_HIGH_THROUGHPUT), group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_CDC_RX_BUFSIZE
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+#define STDIO_MSC_USB_CDC_RX_BUFSIZE 1024
+#else
+#define STDIO_MSC_USB_CDC_RX_BUFSIZE 256
+#endif
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_CDC_TX_BUFSIZE, Size of the CDC transmit FIFO, default=256 (4096 with STDIO_MSC_USB_HIGH_THROUGHPUT), group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_CDC_TX_BUFSIZE
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+#define STDIO_MSC_USB_CDC_TX_BUFSIZE 4096
+#else
+#define STDIO_MSC_USB_CDC_TX_BUFSIZE 256
+#endif
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_MSC_EP_BUFSIZE, Size of the MSC transfer buffer, the data of one READ10/WRITE10 callback, default=4096, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_MSC_EP_BUFSIZE
+#define STDIO_MSC_USB_MSC_EP_BUFSIZE 4096
+#endif
+
+// PICO_CONFIG: STDIO_MSC_USB_APP_PRIORITY_US, Number of microseconds after an SD card access of the application, during which the concurrent mass storage reads only one block per callback, default=20000, group=stdio_msc_usb
+#ifndef STDIO_MSC_USB_APP_PRIORITY_US
+#define STDIO_MSC_USB_APP_PRIORITY_US 20000
+#endif
+
 // PICO_CONFIG: STDIO_MSC_USB_LOW_PRIORITY_IRQ, Explicit User IRQ number to claim for tud_task() background execution instead of letting the implementation pick a free one dynamically (deprecated), advanced=true, group=stdio_msc_usb
 #ifndef STDIO_MSC_USB_LOW_PRIORITY_IRQ
 // this variable is no longer set by default (one is claimed dynamically), but will be respected if specified
@@ -139,6 +177,15 @@ extern "C" {
 
 extern stdio_driver_t stdio_msc_usb;
 
+/*! \brief Statistics of the USB stdout
+ *  \ingroup stdio_msc_usb
+ */
+typedef struct {
+    uint64_t tx_bytes;  ///< bytes written to the CDC
+    uint32_t tx_rate;   ///< bytes/s of the last burst of output lasting at least one second
+    uint32_t tx_peak;   ///< highest tx_rate measured
+} stdio_msc_usb_stats_t;
+
 /*! \brief Explicitly initialize USB stdio and add it to the current set of stdin drivers
  *  \ingroup stdio_msc_usb
  *
@@ -164,12 +211,42 @@ bool stdio_msc_usb_deinit(void);
  */
 bool stdio_msc_usb_connected(void);
 
+/*! \brief Get the statistics of the USB stdout
+ *  \ingroup stdio_msc_usb
+ *
+ *  \param stats the statistics are copied here
+ */
+void stdio_msc_usb_get_stats(stdio_msc_usb_stats_t *stats);
+
 void stdio_msc_usb_enable_irq_tud_task(void);
 
 void stdio_msc_usb_disable_irq_tud_task(void);
 
 void stdio_msc_usb_do_msc(void);
 
+/*! \brief Export the SD card read-only over USB mass storage while the application runs
+ *  \ingroup stdio_msc_usb
+ *
+ *  The SD card is only read from the background task when the application doesn't hold
+ *  the SD card lock, the SD card must not be used from the other core.
+ */
+void stdio_msc_usb_start_concurrent_msc(void);
+
+/*! \brief Stop the read-only export of the SD card
+ *  \ingroup stdio_msc_usb
+ */
+void stdio_msc_usb_stop_concurrent_msc(void);
+
+/*! \brief Tell the concurrent mass storage that the application accesses the SD card
+ *  \ingroup stdio_msc_usb
+ *
+ *  For STDIO_MSC_USB_APP_PRIORITY_US afterwards only single blocks are read for the USB host.
+ */
+void stdio_msc_usb_app_sd_access(void);
+
+bool stdio_msc_usb_sd_available(void);
+void stdio_msc_usb_msc_task(void);
+
 #ifdef __cplusplus
 }
 #endif
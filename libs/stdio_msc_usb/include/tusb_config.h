@@ -33,11 +33,11 @@
 #define CFG_TUSB_RHPORT0_MODE   (OPT_MODE_DEVICE)
 
 #define CFG_TUD_CDC             (1)
-#define CFG_TUD_CDC_RX_BUFSIZE  (256)
-#define CFG_TUD_CDC_TX_BUFSIZE  (256)
+#define CFG_TUD_CDC_RX_BUFSIZE  (STDIO_MSC_USB_CDC_RX_BUFSIZE)
+#define CFG_TUD_CDC_TX_BUFSIZE  (STDIO_MSC_USB_CDC_TX_BUFSIZE)
 
 #define CFG_TUD_MSC             (1)
-#define CFG_TUD_MSC_EP_BUFSIZE  (4096)
+#define CFG_TUD_MSC_EP_BUFSIZE  (STDIO_MSC_USB_MSC_EP_BUFSIZE)
 
 // We use a vendor specific interface but with our own driver
 // Vendor driver only used for Microsoft OS 2.0 descriptor
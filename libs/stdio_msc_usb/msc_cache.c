@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2024 Thomas Eberhardt
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "pico/time.h"
+#include "msc_cache.h"
+
+#define BLKSZ		512
+#define LBA_NONE	UINT32_MAX
+
+msc_cache_stats_t msc_cache_stats;
+
+#if STDIO_MSC_USB_READAHEAD_BLOCKS > 0
+// blocks read ahead
+static uint8_t __attribute__((aligned(4)))
+	ra_buf[STDIO_MSC_USB_READAHEAD_BLOCKS * BLKSZ];
+static uint32_t ra_lba = LBA_NONE;
+static uint32_t ra_cnt;
+// next block to read ahead
+static uint32_t ra_next = LBA_NONE;
+#endif
+
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+// gathered contiguous blocks not yet written
+static uint8_t __attribute__((aligned(4)))
+	wr_buf[STDIO_MSC_USB_WRITE_BLOCKS * BLKSZ];
+static uint32_t wr_lba;
+static uint32_t wr_cnt;
+// time of the last WRITE10 callback
+static uint64_t wr_time;
+// a deferred write failed, reported with the next command
+static bool wr_error;
+#endif
+
+static inline bool overlaps(uint32_t lba1, uint32_t cnt1, uint32_t lba2,
+			    uint32_t cnt2)
+{
+	return cnt1 && cnt2 && lba1 < lba2 + cnt2 && lba2 < lba1 + cnt1;
+}
+
+static bool sd_read(sd_card_t *sd_card_p, uint8_t *buffer, uint32_t lba,
+		    uint32_t blockcnt)
+{
+	msc_cache_stats.sd_reads++;
+	return sd_card_p->read_blocks(sd_card_p, buffer, lba, blockcnt) ==
+		SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static bool sd_write(sd_card_t *sd_card_p, const uint8_t *buffer,
+		     uint32_t lba, uint32_t blockcnt)
+{
+	msc_cache_stats.sd_writes++;
+	return sd_card_p->write_blocks(sd_card_p, buffer, lba, blockcnt) ==
+		SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+static void wr_flush(sd_card_t *sd_card_p)
+{
+	if (wr_cnt) {
+		if (!sd_write(sd_card_p, wr_buf, wr_lba, wr_cnt))
+			wr_error = true;
+		wr_cnt = 0;
+	}
+}
+#endif
+
+// write the gathered blocks, returns false if this or an
+// earlier deferred write failed
+bool msc_cache_flush(sd_card_t *sd_card_p)
+{
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+	bool ok;
+
+	wr_flush(sd_card_p);
+	ok = !wr_error;
+	wr_error = false;
+	return ok;
+#else
+	(void) sd_card_p;
+
+	return true;
+#endif
+}
+
+// forget the readahead, e.g. when the SD card was changed by the
+// application
+void msc_cache_invalidate(void)
+{
+#if STDIO_MSC_USB_READAHEAD_BLOCKS > 0
+	ra_lba = ra_next = LBA_NONE;
+	ra_cnt = 0;
+#endif
+}
+
+// READ10: serve from the readahead buffer if possible,
+// else read from the SD card, and read ahead the next blocks later
+int32_t msc_cache_read(sd_card_t *sd_card_p, uint32_t lba, uint8_t *buffer,
+		       uint32_t blockcnt)
+{
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+	// the host must read what it has written
+	if (overlaps(lba, blockcnt, wr_lba, wr_cnt) &&
+	    !msc_cache_flush(sd_card_p))
+		return -1;
+#endif
+
+#if STDIO_MSC_USB_READAHEAD_BLOCKS > 0
+	if (ra_cnt && lba >= ra_lba && lba + blockcnt <= ra_lba + ra_cnt) {
+		memcpy(buffer, &ra_buf[(lba - ra_lba) * BLKSZ],
+		       blockcnt * BLKSZ);
+		msc_cache_stats.ra_hits++;
+	} else if (!sd_read(sd_card_p, buffer, lba, blockcnt))
+		return -1;
+
+	// assume a sequential read
+	ra_next = lba + blockcnt;
+	if (ra_cnt && ra_next >= ra_lba && ra_next < ra_lba + ra_cnt) {
+		// still in the buffer, unless the next request is longer
+		if (ra_next + blockcnt <= ra_lba + ra_cnt)
+			ra_next = LBA_NONE;
+	}
+#else
+	if (!sd_read(sd_card_p, buffer, lba, blockcnt))
+		return -1;
+#endif
+	return (int32_t) (blockcnt * BLKSZ);
+}
+
+// WRITE10: append to the write buffer if the blocks are contiguous,
+// else write the buffer and start a new one
+int32_t msc_cache_write(sd_card_t *sd_card_p, uint32_t lba,
+			const uint8_t *buffer, uint32_t blockcnt)
+{
+#if STDIO_MSC_USB_READAHEAD_BLOCKS > 0
+	if (overlaps(lba, blockcnt, ra_lba, ra_cnt))
+		msc_cache_invalidate();
+#endif
+
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+	if (wr_error) {
+		wr_error = false;
+		return -1;
+	}
+	wr_time = to_us_since_boot(get_absolute_time());
+	if (wr_cnt && lba == wr_lba + wr_cnt &&
+	    wr_cnt + blockcnt <= STDIO_MSC_USB_WRITE_BLOCKS) {
+		memcpy(&wr_buf[wr_cnt * BLKSZ], buffer, blockcnt * BLKSZ);
+		wr_cnt += blockcnt;
+		msc_cache_stats.wr_gathered++;
+		return (int32_t) (blockcnt * BLKSZ);
+	}
+	if (!msc_cache_flush(sd_card_p))
+		return -1;
+	if (blockcnt <= STDIO_MSC_USB_WRITE_BLOCKS) {
+		memcpy(wr_buf, buffer, blockcnt * BLKSZ);
+		wr_lba = lba;
+		wr_cnt = blockcnt;
+		return (int32_t) (blockcnt * BLKSZ);
+	}
+#endif
+	if (!sd_write(sd_card_p, buffer, lba, blockcnt))
+		return -1;
+	return (int32_t) (blockcnt * BLKSZ);
+}
+
+// Runs after tud_task() returned, while the USB controller transfers
+// data: write a full write buffer, or read ahead. A partial write buffer
+// is kept for STDIO_MSC_USB_WRITE_DELAY_US, the next WRITE10 probably
+// continues it.
+void msc_cache_task(sd_card_t *sd_card_p, bool readahead)
+{
+	uint32_t n, max;
+
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+	if (wr_cnt == STDIO_MSC_USB_WRITE_BLOCKS ||
+	    (wr_cnt && to_us_since_boot(get_absolute_time()) - wr_time >=
+	     STDIO_MSC_USB_WRITE_DELAY_US)) {
+		wr_flush(sd_card_p);
+		return;
+	}
+#endif
+
+#if STDIO_MSC_USB_READAHEAD_BLOCKS > 0
+	if (!readahead || ra_next == LBA_NONE)
+		return;
+	max = sd_card_p->get_num_sectors(sd_card_p);
+	if (ra_next >= max) {
+		ra_next = LBA_NONE;
+		return;
+	}
+	n = max - ra_next;
+	if (n > STDIO_MSC_USB_READAHEAD_BLOCKS)
+		n = STDIO_MSC_USB_READAHEAD_BLOCKS;
+	ra_lba = ra_next;
+	ra_next = LBA_NONE;
+#if STDIO_MSC_USB_WRITE_BLOCKS > 0
+	// don't read ahead stale data of blocks still in the write buffer
+	if (overlaps(ra_lba, n, wr_lba, wr_cnt))
+		wr_flush(sd_card_p);
+#endif
+	if (sd_read(sd_card_p, ra_buf, ra_lba, n))
+		ra_cnt = n;
+	else
+		msc_cache_invalidate();
+#else
+	(void) sd_card_p;
+	(void) readahead;
+	(void) n;
+	(void) max;
+#endif
+}
@@ -25,9 +25,12 @@
  */
 
 #include "tusb.h"
+#include "pico/time.h"
+#include "pico/mutex.h"
 #include "hw_config.h"
 #include "sd_card.h"
 #include "stdio_msc_usb.h"
+#include "msc_cache.h"
 
 typedef enum {
 	SCSI_CMD_VERIFY_10		= 0x2f,
@@ -37,15 +40,85 @@ typedef enum {
 // whether mass storage interface is active
 static bool msc_ejected = true;
 
+// whether the mass storage is exported read-only while the application runs
+static volatile bool msc_concurrent;
+
+// time of the last SD card access by the application
+static volatile uint64_t msc_app_io_time;
+
 void stdio_msc_usb_do_msc(void)
 {
+	sd_card_t *sd_card_p = sd_get_by_num(0);
+
 	stdio_msc_usb_disable_irq_tud_task();
+	msc_cache_invalidate();
 	msc_ejected = false;
-	while (!msc_ejected)
+	while (!msc_ejected) {
 		tud_task();
+		// the SD card works while USB transfers
+		if (sd_card_p != NULL)
+			msc_cache_task(sd_card_p, true);
+	}
+	if (sd_card_p != NULL)
+		msc_cache_flush(sd_card_p);
 	stdio_msc_usb_enable_irq_tud_task();
 }
 
+// Export the SD card read-only while the application keeps running,
+// tud_task() runs in the background and the MSC callbacks read the
+// SD card when the application doesn't use it.
+void stdio_msc_usb_start_concurrent_msc(void)
+{
+	msc_cache_invalidate();
+	msc_concurrent = true;
+	msc_ejected = false;
+}
+
+void stdio_msc_usb_stop_concurrent_msc(void)
+{
+	msc_ejected = true;
+	msc_concurrent = false;
+}
+
+// The application tells that it accesses the SD card, for a while
+// the MSC callbacks read only one block at a time.
+void stdio_msc_usb_app_sd_access(void)
+{
+	msc_app_io_time = time_us_64();
+	msc_cache_invalidate();
+}
+
+// Runs in the background after tud_task(), reads ahead while the USB
+// controller transfers data, unless the application uses the SD card.
+void stdio_msc_usb_msc_task(void)
+{
+	sd_card_t *sd_card_p = sd_get_by_num(0);
+
+	if (sd_card_p == NULL || msc_ejected || !msc_concurrent)
+		return;
+
+	msc_cache_task(sd_card_p, time_us_64() - msc_app_io_time >=
+		       STDIO_MSC_USB_APP_PRIORITY_US);
+}
+
+// Check if tud_task() may run in the background IRQ. If it interrupted
+// the application while it holds the lock of the SD card, the MSC
+// callbacks would deadlock in sd_lock(). The SD card is only used from
+// this core, so it can't be locked between this check and tud_task().
+bool stdio_msc_usb_sd_available(void)
+{
+	sd_card_t *sd_card_p;
+	uint32_t owner;
+
+	if (!msc_concurrent || (sd_card_p = sd_get_by_num(0)) == NULL)
+		return true;
+
+	if (!mutex_try_enter(&sd_card_p->state.mutex, &owner))
+		return false;
+	mutex_exit(&sd_card_p->state.mutex);
+	return true;
+}
+
 // Invoked when received SCSI_CMD_INQUIRY
 // Application fill vendor id, product id and revision with string up
 // to 8, 16, 4 characters respectively
@@ -111,6 +184,10 @@ bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start,
 			// load disk storage
 		} else {
 			// unload disk storage
+			sd_card_t *sd_card_p = sd_get_by_num(0);
+
+			if (sd_card_p != NULL)
+				msc_cache_flush(sd_card_p);
 			msc_ejected = true;
 		}
 	}
@@ -134,7 +211,6 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset,
 {
 	sd_card_t *sd_card_p = sd_get_by_num(0);
 	uint32_t blockcnt;
-	block_dev_err_t rc;
 
 	(void) lun;
 	(void) offset;
@@ -147,18 +223,19 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset,
 
 	blockcnt = bufsize / 512;
 
-	rc = sd_card_p->read_blocks(sd_card_p, buffer, lba, blockcnt);
-	if (rc != SD_BLOCK_DEVICE_ERROR_NONE)
-		return -1;
-	else
-		return blockcnt * 512;
+	// the application has priority, keep the SD card busy only shortly
+	if (msc_concurrent &&
+	    time_us_64() - msc_app_io_time < STDIO_MSC_USB_APP_PRIORITY_US)
+		blockcnt = 1;
+
+	return msc_cache_read(sd_card_p, lba, buffer, blockcnt);
 }
 
 bool tud_msc_is_writable_cb (uint8_t lun)
 {
 	(void) lun;
 
-	return sd_get_by_num(0) != NULL;
+	return sd_get_by_num(0) != NULL && !msc_concurrent;
 }
 
 // Callback invoked when received WRITE10 command.
@@ -168,7 +245,6 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset,
 {
 	sd_card_t *sd_card_p = sd_get_by_num(0);
 	uint32_t blockcnt;
-	block_dev_err_t rc;
 
 	(void) lun;
 	(void) offset;
@@ -176,16 +252,18 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset,
 	if (sd_card_p == NULL || msc_ejected)
 		return -1;
 
+	if (msc_concurrent) {
+		// Additional Sense 27-00 is WRITE_PROTECTED
+		tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
+		return -1;
+	}
+
 	if (lba >= sd_card_p->get_num_sectors(sd_card_p))
 		return -1;
 
 	blockcnt = bufsize / 512;
 
-	rc = sd_card_p->write_blocks(sd_card_p, buffer, lba, blockcnt);
-	if (rc != SD_BLOCK_DEVICE_ERROR_NONE)
-		return -1;
-	else
-		return blockcnt * 512;
+	return msc_cache_write(sd_card_p, lba, buffer, blockcnt);
 }
 
 // Callback invoked when received an SCSI command not in built-in list below
@@ -211,7 +289,7 @@ int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16],
 		break;
 
 	case SCSI_CMD_SYNCHRONIZE_CACHE_10:
-		if (msc_ejected)
+		if (msc_ejected || !msc_cache_flush(sd_get_by_num(0)))
 			resplen = -1;
 		else
 			resplen = 0;		// report success
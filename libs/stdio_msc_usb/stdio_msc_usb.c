@@ -36,6 +36,14 @@ static uint8_t low_priority_irq_num;
 
 static volatile bool irq_tud_task_enabled;
 
+static stdio_msc_usb_stats_t stats;
+static uint64_t burst_start_time, burst_bytes, last_write_time;
+
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+// output is in the CDC FIFO which wasn't flushed yet
+static volatile bool flush_pending;
+#endif
+
 void stdio_msc_usb_enable_irq_tud_task(void) {
     irq_tud_task_enabled = true;
 }
@@ -68,15 +76,49 @@ static int64_t timer_task(__unused alarm_id_t id, __unused void *user_data) {
     }
 }
 
+// make sure the worker runs again after us microseconds, in periodic timer mode it does anyway
+static void request_worker_in_us(uint32_t us) {
+    if (critical_section_is_initialized(&one_shot_timer_crit_sec)) {
+        bool need_timer;
+        critical_section_enter_blocking(&one_shot_timer_crit_sec);
+        need_timer = !one_shot_timer_pending;
+        one_shot_timer_pending = true;
+        critical_section_exit(&one_shot_timer_crit_sec);
+        if (need_timer) {
+            add_alarm_in_us(us, timer_task, NULL, true);
+        }
+    }
+}
+
 static void low_priority_worker_irq(void) {
     if (mutex_try_enter(&stdio_msc_usb_mutex, NULL)) {
-        if (irq_tud_task_enabled) {
+        bool sd_busy = !stdio_msc_usb_sd_available();
+        if (irq_tud_task_enabled && !sd_busy) {
             tud_task();
+            stdio_msc_usb_msc_task();
+        }
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+        // send a partial packet only when the output is idle
+        bool flush_later = false;
+        if (flush_pending) {
+            uint64_t idle = time_us_64() - last_write_time;
+            if (idle >= STDIO_MSC_USB_FLUSH_IDLE_US) {
+                tud_cdc_write_flush();
+                flush_pending = false;
+            } else {
+                flush_later = true;
+            }
         }
+#endif
 #if STDIO_MSC_USB_SUPPORT_CHARS_AVAILABLE_CALLBACK
         uint32_t chars_avail = tud_cdc_available();
 #endif
         mutex_exit(&stdio_msc_usb_mutex);
+        // the application uses the SD card, try again later
+        if (sd_busy) request_worker_in_us(STDIO_MSC_USB_TASK_INTERVAL_US);
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+        if (flush_later) request_worker_in_us(STDIO_MSC_USB_FLUSH_IDLE_US);
+#endif
 #if STDIO_MSC_USB_SUPPORT_CHARS_AVAILABLE_CALLBACK
         if (chars_avail && chars_available_callback) chars_available_callback(chars_available_param);
 #endif
@@ -91,16 +133,7 @@ static void low_priority_worker_irq(void) {
         // we must kick off a one-shot timer to make sure the tud_task() DOES run (this method
         // will be called again as a result, and will try the mutex_try_enter again, and if that fails
         // create another one shot timer again, and so on).
-        if (critical_section_is_initialized(&one_shot_timer_crit_sec)) {
-            bool need_timer;
-            critical_section_enter_blocking(&one_shot_timer_crit_sec);
-            need_timer = !one_shot_timer_pending;
-            one_shot_timer_pending = true;
-            critical_section_exit(&one_shot_timer_crit_sec);
-            if (need_timer) {
-                add_alarm_in_us(STDIO_MSC_USB_TASK_INTERVAL_US, timer_task, NULL, true);
-            }
-        }
+        request_worker_in_us(STDIO_MSC_USB_TASK_INTERVAL_US);
     }
 }
 
@@ -108,20 +141,50 @@ static void usb_irq(void) {
     irq_set_pending(low_priority_irq_num);
 }
 
+// count the output and measure the rate of bursts lasting at least one second,
+// a pause of more than 100ms starts a new burst
+static void count_output(int length) {
+    uint64_t now = time_us_64();
+    if (now - last_write_time > 100000) {
+        burst_start_time = now;
+        burst_bytes = 0;
+    }
+    last_write_time = now;
+    stats.tx_bytes += (uint64_t) length;
+    burst_bytes += (uint64_t) length;
+    if (now - burst_start_time >= 1000000) {
+        stats.tx_rate = (uint32_t) (burst_bytes * 1000000 / (now - burst_start_time));
+        if (stats.tx_rate > stats.tx_peak) stats.tx_peak = stats.tx_rate;
+        burst_start_time = now;
+        burst_bytes = 0;
+    }
+}
+
+void stdio_msc_usb_get_stats(stdio_msc_usb_stats_t *s) {
+    if (!mutex_try_enter_block_until(&stdio_msc_usb_mutex, make_timeout_time_ms(PICO_STDIO_DEADLOCK_TIMEOUT_MS))) {
+        return;
+    }
+    *s = stats;
+    mutex_exit(&stdio_msc_usb_mutex);
+}
+
 static void stdio_msc_usb_out_chars(const char *buf, int length) {
     static uint64_t last_avail_time;
     if (!mutex_try_enter_block_until(&stdio_msc_usb_mutex, make_timeout_time_ms(PICO_STDIO_DEADLOCK_TIMEOUT_MS))) {
         return;
     }
     if (stdio_msc_usb_connected()) {
-        for (int i = 0; i < length;) {
+        int i = 0;
+        while (i < length) {
             int n = length - i;
             int avail = (int) tud_cdc_write_available();
             if (n > avail) n = avail;
             if (n) {
                 int n2 = (int) tud_cdc_write(buf + i, (uint32_t)n);
+#if !STDIO_MSC_USB_HIGH_THROUGHPUT
                 tud_task();
                 tud_cdc_write_flush();
+#endif
                 i += n2;
                 last_avail_time = time_us_64();
             } else {
@@ -133,11 +196,20 @@ static void stdio_msc_usb_out_chars(const char *buf, int length) {
                 }
             }
         }
+        count_output(i);
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+        flush_pending = true;
+#endif
     } else {
         // reset our timeout
         last_avail_time = 0;
     }
     mutex_exit(&stdio_msc_usb_mutex);
+#if STDIO_MSC_USB_HIGH_THROUGHPUT
+    // the worker flushes a partial packet after the output went idle,
+    // full packets are sent by tud_cdc_write() and the transfer complete callback
+    request_worker_in_us(STDIO_MSC_USB_FLUSH_IDLE_US);
+#endif
 }
 
 static void stdio_msc_usb_out_flush(void) {
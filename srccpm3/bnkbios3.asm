@@ -8,6 +8,13 @@
 ; 07-JUL-2024 added RTC
 ; 14-JUL-2024 fixed bug, FCB one byte short
 ; 23-JUL-2024 fixed status bug in READ/WRITE found by Thomas
+; 19-OCT-2026 added 4 MB and 8 MB hard disks, geometry from FDC
+; 19-OCT-2026 select error if there is no disk in the drive
+;
+;	The CP/M 3 system on the disk images in disks/ was generated with
+;	the BIOS before the hard disk support. To use hard disks, build
+;	BNKBIOS3.SPR from this file with RMAC and LINK under CP/M, run
+;	GENCPM and copy the new CPM3.SYS onto cpm3-1.dsk, see README.md.
 ;
 WARM	EQU	0		; BIOS warm start
 BDOS	EQU	5		; BDOS entry
@@ -48,6 +55,7 @@ TPA	EQU	0100H		; start of TPA
 TTY1	EQU	01H		; tty 1 data
 TTY1S	EQU	00H		; tty 1 status
 FDC	EQU	04H		; FDC
+FDCG	EQU	05H		; FDC disk geometry
 MMUSEL	EQU	40H		; MMU bank select
 CLKCMD	EQU	41H		; RTC command
 CLKDAT	EQU	42H		; RTC data
@@ -116,50 +124,53 @@ DRIVES:	DW	DPH0
 	DW	0
 	DW	0
 ;
-;	disk parameter headers for IBM 3740 8" SD disks
+;	disk parameter headers, SELDSK sets translate table and DPB
+;	for the disk in the drive, when the drive is logged in.
+;	Initialized with the DPB for the biggest physical sectors,
+;	so that GENCPM allocates large enough buffers.
 ;
-DPH0:	DW	TRANS		; sector translate table
+DPH0:	DW	0		; sector translate table
 	DB	0,0,0,0		; BDOS scratch area
 	DB	0,0,0,0,0
 	DB	0		; media flag
-	DW	DPBFD		; disk parameter block
-	DW	0FFFEH		; checksum vector
-	DW	0FFFEH		; allocation vector
+	DW	DPBHD8		; disk parameter block
+	DW	CSV0		; checksum vector
+	DW	ALV0		; allocation vector
 	DW	0FFFEH		; directory buffer control block
-	DW	0FFFFH		; DTABCB not used
+	DW	0FFFEH		; data buffer control block
 	DW	0FFFFH		; hashing not used
 	DB	0		; hash bank
-DPH1:	DW	TRANS		; sector translate table
+DPH1:	DW	0		; sector translate table
 	DB	0,0,0,0		; BDOS scratch area
 	DB	0,0,0,0,0
 	DB	0		; media flag
-	DW	DPBFD		; disk parameter block
-	DW	0FFFEH		; checksum vector
-	DW	0FFFEH		; allocation vector
+	DW	DPBHD8		; disk parameter block
+	DW	CSV1		; checksum vector
+	DW	ALV1		; allocation vector
 	DW	0FFFEH		; directory buffer control block
-	DW	0FFFFH		; DTABCB not used
+	DW	0FFFEH		; data buffer control block
 	DW	0FFFFH		; hashing not used
 	DB	0		; hash bank
-DPH2:	DW	TRANS		; sector translate table
+DPH2:	DW	0		; sector translate table
 	DB	0,0,0,0		; BDOS scratch area
 	DB	0,0,0,0,0
 	DB	0		; media flag
-	DW	DPBFD		; disk parameter block
-	DW	0FFFEH		; checksum vector
-	DW	0FFFEH		; allocation vector
+	DW	DPBHD8		; disk parameter block
+	DW	CSV2		; checksum vector
+	DW	ALV2		; allocation vector
 	DW	0FFFEH		; directory buffer control block
-	DW	0FFFFH		; DTABCB not used
+	DW	0FFFEH		; data buffer control block
 	DW	0FFFFH		; hashing not used
 	DB	0		; hash bank
-DPH3:	DW	TRANS		; sector translate table
+DPH3:	DW	0		; sector translate table
 	DB	0,0,0,0		; BDOS scratch area
 	DB	0,0,0,0,0
 	DB	0		; media flag
-	DW	DPBFD		; disk parameter block
-	DW	0FFFEH		; checksum vector
-	DW	0FFFEH		; allocation vector
+	DW	DPBHD8		; disk parameter block
+	DW	CSV3		; checksum vector
+	DW	ALV3		; allocation vector
 	DW	0FFFEH		; directory buffer control block
-	DW	0FFFFH		; DTABCB not used
+	DW	0FFFEH		; data buffer control block
 	DW	0FFFFH		; hashing not used
 	DB	0		; hash bank
 ;
@@ -187,6 +198,36 @@ DPBFD:	DW	26		; sectors per track
 	DW	2		; track offset
 	DB	0,0		; physical sector size and shift
 ;
+;	disk parameter block for 4 MB hard disk,
+;	256 tracks, 32 sectors per track, 512 bytes per sector
+;
+DPBHD4:	DW	128		; 128 byte records per track
+	DB	5		; block shift factor
+	DB	31		; block mask
+	DB	1		; extent mask
+	DW	1023		; disk size - 1
+	DW	1023		; directory max
+	DB	255		; alloc 0
+	DB	0		; alloc 1
+	DW	8000H		; check size, drive is permanent
+	DW	0		; track offset
+	DB	2,3		; physical sector size and shift
+;
+;	disk parameter block for 8 MB hard disk,
+;	256 tracks, 64 sectors per track, 512 bytes per sector
+;
+DPBHD8:	DW	256		; 128 byte records per track
+	DB	5		; block shift factor
+	DB	31		; block mask
+	DB	1		; extent mask
+	DW	2047		; disk size - 1
+	DW	1023		; directory max
+	DB	255		; alloc 0
+	DB	0		; alloc 1
+	DW	8000H		; check size, drive is permanent
+	DW	0		; track offset
+	DB	2,3		; physical sector size and shift
+;
 ;	FDC command bytes
 ;
 CMD:	DS	4
@@ -223,8 +264,21 @@ STACK:
 ;
 	DSEG
 ;
+;	checksum and allocation vectors in bank 0,
+;	allocation vectors large enough for 8 MB hard disks
+;	with double bit allocation vectors
+;
+CSV0:	DS	16
+CSV1:	DS	16
+CSV2:	DS	16
+CSV3:	DS	16
+ALV0:	DS	513
+ALV1:	DS	513
+ALV2:	DS	513
+ALV3:	DS	513
+;
 SIGNON:	DB	13,10
-	DB	'Banked BIOS V1.3',13,10
+	DB	'Banked BIOS V1.4',13,10
 	DB	'Copyright (C) 2024 Udo Munk',13,10,13,10
 	DB	0
 ;
@@ -436,26 +490,50 @@ HOME:	MVI	C,0		; select track 0
 ;
 SELDSK: LXI	H,0		; HL = error return code
 	MOV	A,C		; get disk # to A
-	CPI	0		; disk 0 ?
-	JZ	SEL0		; select disk 0
-	CPI	1		; disk 1 ?
-	JZ	SEL1		; select disk 1
-	CPI	2		; disk 2 ?
-	JZ	SEL2		; select disk 2
-	CPI	3		; disk 3 ?
-	JZ	SEL3		; select disk 3
-	RET			; else return with error
-SEL0:	STA	SDISK
-	LXI	H,DPH0		; HL = disk parameter header disk 0
-	RET
-SEL1:	STA	SDISK
-	LXI	H,DPH1		; HL = disk parameter header disk 1
-	RET
-SEL2:	STA	SDISK
-	LXI	H,DPH2		; HL = disk parameter header disk 2
+	CPI	4		; disk 0 - 3 ?
+	RNC			; no, return with error
+	STA	SDISK
+	MOV	L,C		; HL = disk * 2
+	DAD	H
+	LXI	B,DRIVES	; HL = .DRIVES(disk)
+	DAD	B
+	MOV	A,M		; HL = disk parameter header
+	INX	H
+	MOV	H,M
+	MOV	L,A
+	MOV	A,E		; first select of the drive ?
+	RAR
+	RC			; no, done
+	PUSH	H		; save DPH
+	LDA	SDISK		; ask FDC for the disk geometry
+	OUT	FDCG
+	IN	FDCG		; get disk type
+	ORA	A		; disk in drive ?
+	JNZ	SEL0
+	POP	H		; no, return with error
+	LXI	H,0
 	RET
-SEL3:	STA	SDISK
-	LXI	H,DPH3		; HL = disk parameter header disk 3
+SEL0:	LXI	D,TRANS		; default 8" SSSD floppy
+	LXI	B,DPBFD
+	CPI	2		; 4 MB hard disk ?
+	JNZ	SEL1
+	LXI	D,0		; yes, no translation
+	LXI	B,DPBHD4
+SEL1:	CPI	3		; 8 MB hard disk ?
+	JNZ	SEL2
+	LXI	D,0		; yes, no translation
+	LXI	B,DPBHD8
+SEL2:	POP	H		; get DPH
+	PUSH	H
+	MOV	M,E		; set sector translate table
+	INX	H
+	MOV	M,D
+	LXI	D,11		; HL = .DPB in DPH
+	DAD	D
+	MOV	M,C		; set disk parameter block
+	INX	H
+	MOV	M,B
+	POP	H		; return DPH
 	RET
 ;
 ;	set track given by register C
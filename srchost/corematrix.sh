@@ -0,0 +1,142 @@
+#!/bin/sh
+#
+# Z80SIM  -  a Z80-CPU simulator
+#
+# Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+#
+# Builds picosim with the variants of the emulation selectable in
+# srcsim/sim.h (default, ALT_Z80, ALT_I8080, FAST_BLOCK), runs the
+# benchmark "! bench" with the host build of each variant and prints
+# a table with the emulated MHz of every program.
+#
+# With -d the variants are also built for RP2040, RP2350 ARM and
+# RP2350 RISC-V with the ICE (PICO_SDK_PATH must be set), the table
+# then shows the flash and RAM used as printed by the linker. The
+# devices can't be run from here: save the console output of "! bench"
+# of a device as build-matrix/<platform>-<variant>.log, e.g.
+# build-matrix/rp2040-ALT_Z80.log, and run this again, the results
+# are added to the table.
+#
+#	srchost/corematrix.sh [-d] [-z ../z80pack] sdcard.img
+#
+# History:
+# 19-OCT-2026 first version
+#
+
+VARIANTS="default ALT_Z80 ALT_I8080 FAST_BLOCK"
+PLATFORMS="rp2040 rp2350-arm-s rp2350-riscv"
+OUT=build-matrix
+
+TOP=$(cd "$(dirname "$0")/.." && pwd)
+Z80PACK=$TOP/../z80pack
+DEVICE=0
+
+usage() {
+	echo "usage: $0 [-d] [-z z80pack] sdcard.img" >&2
+	exit 1
+}
+
+while getopts dz: opt; do
+	case $opt in
+	d)	DEVICE=1 ;;
+	z)	Z80PACK=$(cd "$OPTARG" && pwd) ;;
+	*)	usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 1 ] && [ -f "$1" ] || usage
+IMG=$1
+
+# defines for sim.h of a variant
+defs() {
+	if [ "$1" = default ]; then
+		echo "$2"
+	elif [ -n "$2" ]; then
+		echo "$1;$2"
+	else
+		echo "$1"
+	fi
+}
+
+# name=mhz of all programs in the output of "! bench"
+mhz() {
+	tr -d '\r' < "$1" |
+	sed -n 's/^bench name=\([^ ]*\) .* mhz=\([0-9.]*\) .*/\1=\2/p' |
+	tr '\n' ' '
+}
+
+# used size of a memory region in the output of the linker
+mem() {
+	awk -v r="$2:" '$1 == r { print $2 $3; exit }' "$1"
+}
+
+mkdir -p $OUT
+: > $OUT/results
+
+for v in $VARIANTS; do
+	d=$OUT/host-$v
+	echo "building host $v" >&2
+	if ! cmake -S "$TOP/srchost" -B $d -DZ80PACK="$Z80PACK" \
+	    -DHOST_ICE=ON -DPICOSIM_CORE_DEFS="$(defs $v)" \
+	    > $d.log 2>&1 || ! cmake --build $d >> $d.log 2>&1; then
+		echo "$v host failed" >> $OUT/results
+		continue
+	fi
+	echo "running host $v" >&2
+	cp "$IMG" $d/sdcard.img
+	printf 'g! bench\rq\r' |
+	PICOSIM_SDIMG=$d/sdcard.img $d/picosim > $d/bench.log 2>&1
+	echo "$v host - - $(mhz $d/bench.log)" >> $OUT/results
+done
+
+if [ $DEVICE = 1 ]; then
+	if [ -z "$PICO_SDK_PATH" ]; then
+		echo "PICO_SDK_PATH not set" >&2
+		exit 1
+	fi
+	for p in $PLATFORMS; do
+		for v in $VARIANTS; do
+			d=$OUT/$p-$v
+			echo "building $p $v" >&2
+			if ! cmake -S "$TOP/srcsim" -B $d -DPICO_PLATFORM=$p \
+			    -DPICOSIM_CORE_DEFS="$(defs $v WANT_ICE)" \
+			    > $d.build 2>&1 ||
+			   ! cmake --build $d >> $d.build 2>&1; then
+				echo "$v $p failed" >> $OUT/results
+				continue
+			fi
+			r=""
+			[ -f $d.log ] && r=$(mhz $d.log)
+			echo "$v $p $(mem $d.build FLASH) $(mem $d.build RAM)" \
+			     "$r" >> $OUT/results
+		done
+	done
+fi
+
+# one column per program, in the order of the benchmark
+awk '
+{
+	row[NR] = $1 " " $2 " " $3 " " $4
+	for (i = 5; i <= NF; i++) {
+		split($i, a, "=")
+		if (!(a[1] in seen)) {
+			seen[a[1]] = 1
+			names[++n] = a[1]
+		}
+		val[NR, a[1]] = a[2]
+	}
+}
+END {
+	printf "%-11s %-13s %-9s %-9s", "variant", "platform", "flash", "ram"
+	for (j = 1; j <= n; j++)
+		printf " %9s", names[j]
+	printf "\n"
+	for (i = 1; i <= NR; i++) {
+		split(row[i], r, " ")
+		printf "%-11s %-13s %-9s %-9s", r[1], r[2], r[3], r[4]
+		for (j = 1; j <= n; j++)
+			printf " %9s", ((i, names[j]) in val) ? \
+			       val[i, names[j]] : "-"
+		printf "\n"
+	}
+}' $OUT/results
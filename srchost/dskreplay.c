@@ -0,0 +1,194 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Replay a disk access trace recorded by picosim with DISKTRACE through
+ * the sector I/O of srcsim/disks.c, against the disk images on an image
+ * of the MicroSD card. Reported are the SD card commands and 512 byte
+ * blocks read and written, with the caching disks.c does in the build
+ * used: raw I/O for contiguous images, the system tracks of drive 0 and
+ * with HOST_PLATFORM=rp2350 the disk image in RAM, selected with -r.
+ * Disks are given by their name in /DISKS80 without .DSK, "-" for none.
+ * Written sectors are filled with 0xe5, use a scratch copy:
+ *
+ *	cp sdcard.img scratch.img
+ *	build-host/dskreplay scratch.img DSKTRACE.DAT CPM3-1 CPM3-2
+ *
+ * The latencies in the trace are the ones measured on the device,
+ * the replay doesn't measure time.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simmem.h"
+#include "ff.h"
+#include "disks.h"
+#include "dsktrace.h"
+#include "sdimg.h"
+
+#define DMA_ADDR 0x0100		/* memory used for the sector data */
+
+static struct dsktrace_rec *trace;	/* the trace records */
+static size_t ntrace;			/* number of trace records */
+
+static void load_trace(const char *name)
+{
+	FILE *fp;
+	char magic[4];
+	size_t n = 0, max = 0;
+
+	if ((fp = fopen(name, "rb")) == NULL) {
+		perror(name);
+		exit(EXIT_FAILURE);
+	}
+	if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+	    memcmp(magic, DSKTRACE_MAGIC, sizeof(magic)) != 0) {
+		fprintf(stderr, "%s: not a disk trace\n", name);
+		exit(EXIT_FAILURE);
+	}
+	while (1) {
+		if (n == max) {
+			max = max ? max * 2 : 1024;
+			trace = realloc(trace, max * sizeof(*trace));
+			if (trace == NULL) {
+				perror("realloc");
+				exit(EXIT_FAILURE);
+			}
+		}
+		if (fread(&trace[n], sizeof(*trace), 1, fp) != 1)
+			break;
+		n++;
+	}
+	fclose(fp);
+	ntrace = n;
+}
+
+/*
+ * print what the trace recorded on the device
+ */
+static void summary(void)
+{
+	unsigned long nrd = 0, nwr = 0, nerr = 0;
+	uint64_t lat = 0;
+	uint32_t lmax = 0;
+	register size_t i;
+
+	for (i = 0; i < ntrace; i++) {
+		if (trace[i].op == DSKTRACE_WRITE)
+			nwr++;
+		else
+			nrd++;
+		if (trace[i].stat != 0)
+			nerr++;
+		lat += trace[i].latency;
+		if (trace[i].latency > lmax)
+			lmax = trace[i].latency;
+	}
+
+	printf("device: requests=%zu reads=%lu writes=%lu errors=%lu "
+	       "span_us=%lu lat_avg_us=%lu lat_max_us=%lu\n", ntrace,
+	       nrd, nwr, nerr,
+	       ntrace ? (unsigned long) trace[ntrace - 1].time : 0,
+	       ntrace ? (unsigned long) (lat / ntrace) : 0,
+	       (unsigned long) lmax);
+}
+
+/*
+ * replay all requests of the trace with disks.c
+ */
+static void replay(void)
+{
+	unsigned long nerr = 0, ndiff = 0;
+	const struct dsktrace_rec *r;
+	register size_t i;
+	BYTE stat;
+
+	memset(&sdimg_stats, 0, sizeof(sdimg_stats));
+
+	for (i = 0; i < ntrace; i++) {
+		r = &trace[i];
+		if (r->op == DSKTRACE_WRITE) {
+			memset(&bnk0[DMA_ADDR], 0xe5, HDSEC_SZ);
+			stat = write_sec(r->drive, r->track, r->sector,
+					 DMA_ADDR);
+		} else
+			stat = read_sec(r->drive, r->track, r->sector,
+					DMA_ADDR);
+		if (stat != 0)
+			nerr++;
+		if (stat != r->stat)
+			ndiff++;
+	}
+
+	/* includes the write back of the disk image in RAM */
+	exit_disks();
+
+	printf("replay: requests=%zu errors=%lu stat_diff=%lu "
+	       "sd_rd_cmds=%lu sd_rd_blks=%lu sd_wr_cmds=%lu sd_wr_blks=%lu\n",
+	       ntrace, nerr, ndiff, sdimg_stats.rd_cmds, sdimg_stats.rd_blks,
+	       sdimg_stats.wr_cmds, sdimg_stats.wr_blks);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-r drive] sdcard.img trace "
+		"disk0|- [disk1|- [disk2|- [disk3|-]]]\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	int c, i, trk, spt, secsz;
+
+	while ((c = getopt(argc, argv, "r:")) != -1) {
+		switch (c) {
+		case 'r':
+#ifdef RAMDISK
+			ramdisk = atoi(optarg);
+			if (ramdisk < 0 || ramdisk >= NUMDISK)
+				usage(argv[0]);
+			break;
+#else
+			fprintf(stderr, "%s: no RAM disk, build with "
+				"HOST_PLATFORM=rp2350\n", argv[0]);
+			exit(EXIT_FAILURE);
+#endif
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind < 3 || argc - optind > NUMDISK + 2)
+		usage(argv[0]);
+
+	setenv("PICOSIM_SDIMG", argv[optind++], 1);
+	load_trace(argv[optind++]);
+
+	/* written back only at the end, the replay has no idle time */
+	ramdisk_flush = 0;
+
+	init_disks();
+	for (i = 0; i < NUMDISK && optind + i < argc; i++) {
+		if (strcmp(argv[optind + i], "-") == 0)
+			continue;
+		mount_disk(i, argv[optind + i]);
+		if (disks[i][0] == '\0')
+			exit(EXIT_FAILURE);
+		disk_geom(i, &trk, &spt, &secsz);
+		printf("drive %d: %s tracks=%d spt=%d secsz=%d\n",
+		       i, disks[i], trk, spt, secsz);
+	}
+
+	summary();
+	replay();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,517 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: implements the parts of the Raspberry Pico SDK used by
+ * picosim for POSIX systems, so that the machine can be run and
+ * measured on a developer machine without the hardware.
+ *
+ *	console		the terminal in raw mode, Ctrl-\ is the User Key,
+ *			delivered when the console or timer is polled,
+ *			the program terminates at the end of the input
+ *	core 1		a thread
+ *	alarms		a thread for each alarm
+ *	LCD		a model of the LCD controller, which receives the
+ *			bytes written to the SPI into a frame buffer, the
+ *			frame buffer is written as PPM file to the file
+ *			named in the environment variable PICOSIM_LCD on exit
+ *	RTC		the host clock
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <pthread.h>
+
+#include "pico.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "pico/multicore.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/rtc.h"
+#include "hardware/watchdog.h"
+#include "WS2812.pio.h"
+
+#include "LCD_Driver.h"
+
+const struct pio_program ws2812_program;
+
+/*
+ *	console
+ */
+
+static struct termios old_term;
+static bool term_raw;
+static gpio_irq_callback_t irq_callback;
+
+static void restore_term(void)
+{
+	if (term_raw)
+		tcsetattr(STDIN_FILENO, TCSAFLUSH, &old_term);
+	term_raw = false;
+}
+
+/* Ctrl-\ works like the User Key, the signal handler only sets a flag, */
+/* the GPIO callback is called when the console or the timer is polled */
+static volatile sig_atomic_t user_key;
+
+static void sigquit(int sig)
+{
+	(void) sig;
+
+	user_key = 1;
+}
+
+static void poll_user_key(void)
+{
+	if (user_key) {
+		user_key = 0;
+		if (irq_callback != NULL)
+			(*irq_callback)(2, GPIO_IRQ_EDGE_FALL);
+	}
+}
+
+bool stdio_init_all(void)
+{
+	struct termios t;
+	struct sigaction sa;
+
+	setvbuf(stdin, NULL, _IONBF, 0);
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &old_term) == 0) {
+		t = old_term;
+		t.c_lflag &= ~(ICANON | ECHO);
+		t.c_iflag &= ~(ICRNL | IXON);
+		t.c_cc[VINTR] = _POSIX_VDISABLE; /* ^C is for the guest */
+		t.c_cc[VSUSP] = _POSIX_VDISABLE;
+		t.c_cc[VMIN] = 1;
+		t.c_cc[VTIME] = 0;
+		if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &t) == 0) {
+			term_raw = true;
+			atexit(restore_term);
+		}
+	}
+	/* no SA_RESTART, a blocked read of the console must return */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sigquit;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGQUIT, &sa, NULL);
+
+	return true;
+}
+
+int putchar_raw(int c)
+{
+	return putchar(c);
+}
+
+int hal_getchar(void)
+{
+	struct pollfd p = { .fd = STDIN_FILENO, .events = POLLIN };
+	int c;
+
+	/* wait for input, a Ctrl-\ interrupts the wait */
+	do
+		poll_user_key();
+	while (poll(&p, 1, -1) == -1);
+
+	if ((c = getc(stdin)) == EOF)
+		exit(EXIT_SUCCESS);
+	return c;
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+	static bool first = true;
+	struct pollfd p = { .fd = STDIN_FILENO, .events = POLLIN };
+
+	(void) uart;
+
+	poll_user_key();
+
+	/* the first check in main() discards noise from the UART, */
+	/* there is none here and scripted input must not be lost */
+	if (first) {
+		first = false;
+		return false;
+	}
+	return poll(&p, 1, 0) == 1;
+}
+
+void panic(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	exit(EXIT_FAILURE);
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms)
+{
+	(void) pc;
+	(void) sp;
+	(void) delay_ms;
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ *	clocks, only remembered for the messages
+ */
+
+static uint32_t sys_hz = HOST_CLK_MHZ * 1000000;
+
+uint32_t clock_get_hz(enum clock_index clk_index)
+{
+	return (clk_index == clk_ref) ? 12000000 : sys_hz;
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+	(void) required;
+
+	sys_hz = freq_khz * 1000;
+	return true;
+}
+
+/*
+ *	time and alarms
+ */
+
+absolute_time_t get_absolute_time(void)
+{
+	static uint64_t t0;
+	struct timespec ts;
+	uint64_t t;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t = (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+	if (t0 == 0)
+		t0 = t - 1;
+	return t - t0;
+}
+
+void sleep_us(uint64_t us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	while (nanosleep(&ts, &ts) == -1)
+		;
+	poll_user_key();
+}
+
+void sleep_ms(uint32_t ms)
+{
+	sleep_us((uint64_t) ms * 1000);
+}
+
+/*
+ * Pending alarms are kept in a list, so that cancel_alarm() can find
+ * them by their id. An alarm stays in the list until its thread has
+ * checked the cancelled flag and removed it.
+ */
+struct alarm {
+	struct alarm *next;
+	alarm_id_t id;
+	uint32_t ms;
+	alarm_callback_t callback;
+	void *user_data;
+	bool cancelled;
+};
+
+static struct alarm *alarms;
+static pthread_mutex_t alarm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *alarm_thread(void *arg)
+{
+	struct alarm *a = arg, **p;
+	bool cancelled;
+
+	sleep_ms(a->ms);
+
+	pthread_mutex_lock(&alarm_lock);
+	for (p = &alarms; *p != a; p = &(*p)->next)
+		;
+	*p = a->next;
+	cancelled = a->cancelled;
+	pthread_mutex_unlock(&alarm_lock);
+
+	if (!cancelled)
+		(*a->callback)(a->id, a->user_data);
+	free(a);
+	return NULL;
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback,
+			   void *user_data, bool fire_if_past)
+{
+	static alarm_id_t next_id;
+	alarm_id_t id;
+	struct alarm *a;
+	pthread_t thread;
+
+	(void) fire_if_past;
+
+	if ((a = malloc(sizeof(*a))) == NULL)
+		return -1;
+	a->ms = ms;
+	a->callback = callback;
+	a->user_data = user_data;
+	a->cancelled = false;
+
+	pthread_mutex_lock(&alarm_lock);
+	a->id = id = ++next_id;
+	a->next = alarms;
+	alarms = a;
+	if (pthread_create(&thread, NULL, alarm_thread, a) != 0) {
+		alarms = a->next;
+		pthread_mutex_unlock(&alarm_lock);
+		free(a);
+		return -1;
+	}
+	pthread_mutex_unlock(&alarm_lock);
+	pthread_detach(thread);
+	return id;
+}
+
+bool cancel_alarm(alarm_id_t id)
+{
+	struct alarm *a;
+	bool found = false;
+
+	pthread_mutex_lock(&alarm_lock);
+	for (a = alarms; a != NULL; a = a->next)
+		if (a->id == id && !a->cancelled) {
+			a->cancelled = true;
+			found = true;
+			break;
+		}
+	pthread_mutex_unlock(&alarm_lock);
+	return found;
+}
+
+/*
+ *	core 1
+ */
+
+static pthread_t core1;
+static bool core1_running;
+
+static void *core1_thread(void *arg)
+{
+	void (*entry)(void) = (void (*)(void)) arg;
+
+	(*entry)();
+	return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+	if (pthread_create(&core1, NULL, core1_thread, (void *) entry) != 0)
+		panic("can't start core 1\n");
+	core1_running = true;
+}
+
+void multicore_reset_core1(void)
+{
+	if (core1_running) {
+		pthread_cancel(core1);
+		pthread_join(core1, NULL);
+		core1_running = false;
+	}
+}
+
+/*
+ *	GPIO
+ */
+
+static bool lcd_dc, lcd_cs = true;
+
+void gpio_put(uint gpio, bool value)
+{
+	if (gpio == LCD_DC_PIN)
+		lcd_dc = value;
+	else if (gpio == LCD_CS_PIN)
+		lcd_cs = value;
+}
+
+bool gpio_get(uint gpio)
+{
+	(void) gpio;
+
+	return true;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events,
+					bool enabled,
+					gpio_irq_callback_t callback)
+{
+	(void) gpio;
+	(void) events;
+
+	irq_callback = enabled ? callback : NULL;
+}
+
+/*
+ *	model of the LCD controller, only what the LCD driver uses:
+ *	column/page address set and memory write in landscape mode
+ */
+
+static uint16_t lcd_fb[LCD_Y_MAXPIXEL][LCD_X_MAXPIXEL];
+static uint8_t lcd_cmd;			/* last command received */
+static int lcd_nparm;			/* parameter bytes received */
+static uint16_t lcd_xs, lcd_xe, lcd_ys, lcd_ye; /* window */
+static uint16_t lcd_x, lcd_y;		/* memory write position */
+static uint8_t lcd_hi;			/* high byte of pixel */
+static uint64_t lcd_bytes, lcd_pixels;	/* statistics */
+
+static void lcd_byte(uint8_t b)
+{
+	lcd_bytes++;
+
+	if (!lcd_dc) {
+		lcd_cmd = b;
+		lcd_nparm = 0;
+		if (b == 0x2c) {
+			lcd_x = lcd_xs;
+			lcd_y = lcd_ys;
+		}
+		return;
+	}
+
+	switch (lcd_cmd) {
+	case 0x2a:	/* column address set */
+	case 0x2b:	/* page address set */
+		switch (lcd_nparm) {
+		case 0: lcd_hi = b; break;
+		case 1: *(lcd_cmd == 0x2a ? &lcd_xs : &lcd_ys) =
+				(lcd_hi << 8) | b; break;
+		case 2: lcd_hi = b; break;
+		case 3: *(lcd_cmd == 0x2a ? &lcd_xe : &lcd_ye) =
+				(lcd_hi << 8) | b; break;
+		default: break;
+		}
+		break;
+
+	case 0x2c:	/* memory write */
+		if ((lcd_nparm & 1) == 0) {
+			lcd_hi = b;
+			break;
+		}
+		if (lcd_x < LCD_X_MAXPIXEL && lcd_y < LCD_Y_MAXPIXEL)
+			lcd_fb[lcd_y][lcd_x] = (lcd_hi << 8) | b;
+		lcd_pixels++;
+		if (lcd_x++ >= lcd_xe) {
+			lcd_x = lcd_xs;
+			if (lcd_y++ >= lcd_ye)
+				lcd_y = lcd_ys;
+		}
+		break;
+
+	default:
+		break;
+	}
+	lcd_nparm++;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+	size_t i;
+
+	if (spi == SPI_PORT && !lcd_cs)
+		for (i = 0; i < len; i++)
+			lcd_byte(src[i]);
+	return (int) len;
+}
+
+static void lcd_dump(void)
+{
+	const char *name = getenv("PICOSIM_LCD");
+	FILE *fp;
+	uint16_t c;
+	int x, y;
+
+	if (name == NULL)
+		return;
+
+	if ((fp = fopen(name, "wb")) == NULL) {
+		perror(name);
+		return;
+	}
+	fprintf(fp, "P6\n%d %d\n255\n", LCD_X_MAXPIXEL, LCD_Y_MAXPIXEL);
+	for (y = 0; y < LCD_Y_MAXPIXEL; y++)
+		for (x = 0; x < LCD_X_MAXPIXEL; x++) {
+			c = lcd_fb[y][x];
+			putc(((c >> 11) & 0x1f) * 255 / 31, fp);
+			putc(((c >> 5) & 0x3f) * 255 / 63, fp);
+			putc((c & 0x1f) * 255 / 31, fp);
+		}
+	fclose(fp);
+
+	restore_term();
+	fprintf(stderr, "LCD: %llu bytes written, %llu pixels, "
+		"frame buffer in %s\n", (unsigned long long) lcd_bytes,
+		(unsigned long long) lcd_pixels, name);
+}
+
+/*
+ *	RTC, the host clock with an offset
+ */
+
+static time_t rtc_offset;
+
+bool rtc_set_datetime(const datetime_t *t)
+{
+	struct tm tm;
+
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = t->year - 1900;
+	tm.tm_mon = t->month - 1;
+	tm.tm_mday = t->day;
+	tm.tm_hour = t->hour;
+	tm.tm_min = t->min;
+	tm.tm_sec = t->sec;
+	tm.tm_isdst = -1;
+	rtc_offset = mktime(&tm) - time(NULL);
+	return true;
+}
+
+bool rtc_get_datetime(datetime_t *t)
+{
+	time_t now = time(NULL) + rtc_offset;
+	struct tm *tm = localtime(&now);
+
+	t->year = tm->tm_year + 1900;
+	t->month = tm->tm_mon + 1;
+	t->day = tm->tm_mday;
+	t->dotw = tm->tm_wday;
+	t->hour = tm->tm_hour;
+	t->min = tm->tm_min;
+	t->sec = tm->tm_sec;
+	return true;
+}
+
+/*
+ *	runs before main() of picosim
+ */
+static void __attribute__((constructor)) hal_init(void)
+{
+	atexit(lcd_dump);
+}
@@ -0,0 +1,34 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: replaces the header generated from WS2812.pio
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef WS2812_PIO_H
+#define WS2812_PIO_H
+
+#include "hardware/pio.h"
+
+#define ws2812_T1 2
+#define ws2812_T2 5
+#define ws2812_T3 3
+
+struct pio_program {
+	int dummy;
+};
+
+extern const struct pio_program ws2812_program;
+
+static inline void ws2812_program_init(PIO pio, uint sm, uint offset,
+				       uint pin, float freq, bool rgbw)
+{
+	(void) pio; (void) sm; (void) offset; (void) pin; (void) freq;
+	(void) rgbw;
+}
+
+#endif /* !WS2812_PIO_H */
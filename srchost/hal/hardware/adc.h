@@ -0,0 +1,26 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/adc.h, the temperature sensor reads 27 C
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_ADC_H
+#define HARDWARE_ADC_H
+
+#include "pico.h"
+
+static inline void adc_init(void) { }
+static inline void adc_set_temp_sensor_enabled(bool enable) { (void) enable; }
+static inline void adc_select_input(uint input) { (void) input; }
+
+static inline uint16_t adc_read(void)
+{
+	return 876;	/* 0.706 V */
+}
+
+#endif /* !HARDWARE_ADC_H */
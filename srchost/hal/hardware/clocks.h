@@ -0,0 +1,34 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/clocks.h, the system clock only is a number,
+ * the emulation runs as fast as the host can
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_CLOCKS_H
+#define HARDWARE_CLOCKS_H
+
+#include "pico.h"
+
+enum clock_index { clk_ref, clk_sys, clk_peri };
+
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS 0
+
+extern uint32_t clock_get_hz(enum clock_index clk_index);
+extern bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+
+static inline bool clock_configure(enum clock_index clk_index, uint32_t src,
+				   uint32_t auxsrc, uint32_t src_freq,
+				   uint32_t freq)
+{
+	(void) clk_index; (void) src; (void) auxsrc; (void) src_freq;
+	(void) freq;
+	return true;
+}
+
+#endif /* !HARDWARE_CLOCKS_H */
@@ -0,0 +1,34 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/divider.h
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_DIVIDER_H
+#define HARDWARE_DIVIDER_H
+
+#include "pico.h"
+
+typedef uint64_t divmod_result_t;
+
+static inline divmod_result_t hw_divider_divmod_u32(uint32_t a, uint32_t b)
+{
+	return ((uint64_t) (a % b) << 32) | (a / b);
+}
+
+static inline uint32_t to_quotient_u32(divmod_result_t r)
+{
+	return (uint32_t) r;
+}
+
+static inline uint32_t to_remainder_u32(divmod_result_t r)
+{
+	return (uint32_t) (r >> 32);
+}
+
+#endif /* !HARDWARE_DIVIDER_H */
@@ -0,0 +1,48 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/gpio.h, the IRQ callback is called on SIGQUIT,
+ * the pins are only used to drive the LCD model in hal.c
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_GPIO_H
+#define HARDWARE_GPIO_H
+
+#include "pico.h"
+
+#define GPIO_IN		false
+#define GPIO_OUT	true
+
+#define GPIO_IRQ_EDGE_FALL	0x4u
+#define GPIO_IRQ_EDGE_RISE	0x8u
+
+enum gpio_function {
+	GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_PWM = 4,
+	GPIO_FUNC_SIO = 5, GPIO_FUNC_NULL = 0x1f
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+extern void gpio_put(uint gpio, bool value);
+extern bool gpio_get(uint gpio);
+extern void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events,
+					       bool enabled,
+					       gpio_irq_callback_t callback);
+
+static inline void gpio_init(uint gpio) { (void) gpio; }
+static inline void gpio_set_dir(uint gpio, bool out)
+{
+	(void) gpio; (void) out;
+}
+static inline void gpio_pull_up(uint gpio) { (void) gpio; }
+static inline void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+	(void) gpio; (void) fn;
+}
+
+#endif /* !HARDWARE_GPIO_H */
@@ -0,0 +1,47 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/pio.h, only what is needed for the RGB LED,
+ * which isn't there
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_PIO_H
+#define HARDWARE_PIO_H
+
+#include "pico.h"
+
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t *PIO;
+typedef struct pio_program pio_program_t;
+
+#define pio0 ((PIO) 0)
+#define pio1 ((PIO) 0)
+
+static inline uint pio_claim_unused_sm(PIO pio, bool required)
+{
+	(void) pio; (void) required;
+	return 0;
+}
+
+static inline uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+	(void) pio; (void) program;
+	return 0;
+}
+
+static inline void pio_sm_set_clkdiv(PIO pio, uint sm, float div)
+{
+	(void) pio; (void) sm; (void) div;
+}
+
+static inline void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+	(void) pio; (void) sm; (void) data;
+}
+
+#endif /* !HARDWARE_PIO_H */
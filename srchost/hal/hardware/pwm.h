@@ -0,0 +1,40 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/pwm.h, for the LCD backlight
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_PWM_H
+#define HARDWARE_PWM_H
+
+#include "pico.h"
+
+enum pwm_chan { PWM_CHAN_A = 0, PWM_CHAN_B = 1 };
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+	return (gpio >> 1) & 7;
+}
+
+static inline void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+	(void) slice_num; (void) wrap;
+}
+
+static inline void pwm_set_chan_level(uint slice_num, uint chan,
+				      uint16_t level)
+{
+	(void) slice_num; (void) chan; (void) level;
+}
+
+static inline void pwm_set_enabled(uint slice_num, bool enabled)
+{
+	(void) slice_num; (void) enabled;
+}
+
+#endif /* !HARDWARE_PWM_H */
@@ -0,0 +1,31 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/rtc.h, the RTC is the host clock
+ * plus the offset set with rtc_set_datetime()
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_RTC_H
+#define HARDWARE_RTC_H
+
+#include "pico.h"
+
+typedef struct {
+	int16_t year;
+	int8_t month;
+	int8_t day;
+	int8_t dotw;
+	int8_t hour;
+	int8_t min;
+	int8_t sec;
+} datetime_t;
+
+extern bool rtc_set_datetime(const datetime_t *t);
+extern bool rtc_get_datetime(datetime_t *t);
+
+#endif /* !HARDWARE_RTC_H */
@@ -0,0 +1,38 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/spi.h, the bytes written go to the LCD model
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_SPI_H
+#define HARDWARE_SPI_H
+
+#include "pico.h"
+
+typedef struct spi_inst spi_inst_t;
+
+#define spi0 ((spi_inst_t *) 0)
+#define spi1 ((spi_inst_t *) 1)
+
+extern int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+
+static inline uint spi_init(spi_inst_t *spi, uint baudrate)
+{
+	(void) spi;
+	return baudrate;
+}
+
+static inline uint spi_set_baudrate(spi_inst_t *spi, uint baudrate)
+{
+	(void) spi;
+	return baudrate;
+}
+
+static inline void spi_deinit(spi_inst_t *spi) { (void) spi; }
+
+#endif /* !HARDWARE_SPI_H */
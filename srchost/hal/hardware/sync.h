@@ -0,0 +1,23 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/sync.h, memory barrier between the threads
+ * of the cores
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_SYNC_H
+#define HARDWARE_SYNC_H
+
+#include "pico.h"
+
+static inline void __dmb(void)
+{
+	__sync_synchronize();
+}
+
+#endif /* !HARDWARE_SYNC_H */
@@ -0,0 +1,41 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/uart.h, the default UART is the terminal
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_UART_H
+#define HARDWARE_UART_H
+
+#include "pico.h"
+
+typedef struct uart_inst uart_inst_t;
+
+#define uart_default ((uart_inst_t *) 0)
+#define PICO_DEFAULT_UART_BAUD_RATE 115200
+
+extern bool uart_is_readable(uart_inst_t *uart);
+
+static inline bool uart_is_writable(uart_inst_t *uart)
+{
+	(void) uart;
+	return true;
+}
+
+static inline void uart_tx_wait_blocking(uart_inst_t *uart)
+{
+	(void) uart;
+}
+
+static inline uint uart_set_baudrate(uart_inst_t *uart, uint baudrate)
+{
+	(void) uart;
+	return baudrate;
+}
+
+#endif /* !HARDWARE_UART_H */
@@ -0,0 +1,29 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/vreg.h
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_VREG_H
+#define HARDWARE_VREG_H
+
+#include "pico.h"
+
+enum vreg_voltage {
+	VREG_VOLTAGE_1_10,
+	VREG_VOLTAGE_1_15,
+	VREG_VOLTAGE_1_20,
+	VREG_VOLTAGE_DEFAULT = VREG_VOLTAGE_1_10
+};
+
+static inline void vreg_set_voltage(enum vreg_voltage voltage)
+{
+	(void) voltage;
+}
+
+#endif /* !HARDWARE_VREG_H */
@@ -0,0 +1,20 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: hardware/watchdog.h, a reboot terminates the program
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HARDWARE_WATCHDOG_H
+#define HARDWARE_WATCHDOG_H
+
+#include "pico.h"
+
+extern void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms)
+	__attribute__((noreturn));
+
+#endif /* !HARDWARE_WATCHDOG_H */
@@ -0,0 +1,21 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: replaces hw_config.h of no-OS-FatFS-SD-SDIO-SPI-RPi-Pico
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef HW_CONFIG_H
+#define HW_CONFIG_H
+
+#include <stddef.h>
+#include "sd_card.h"
+
+extern size_t sd_get_num(void);
+extern sd_card_t *sd_get_by_num(size_t num);
+
+#endif /* !HW_CONFIG_H */
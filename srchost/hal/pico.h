@@ -0,0 +1,39 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: the parts of the Raspberry Pico SDK used by picosim,
+ * implemented for POSIX systems in hal.c and sdimg.c.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef PICO_H
+#define PICO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) func_name
+#ifndef __aligned
+#define __aligned(x) __attribute__((__aligned__(x)))
+#endif
+
+#define SYS_CLK_MHZ HOST_CLK_MHZ	/* clock of the emulated Pico */
+
+static inline void __nop(void) { __asm__ volatile (""); }
+static inline void tight_loop_contents(void) { }
+
+extern void panic(const char *fmt, ...)
+	__attribute__((noreturn, format(printf, 1, 2)));
+
+#endif /* !PICO_H */
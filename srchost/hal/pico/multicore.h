@@ -0,0 +1,20 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: pico/multicore.h, core 1 is a thread
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef PICO_MULTICORE_H
+#define PICO_MULTICORE_H
+
+#include "pico.h"
+
+extern void multicore_launch_core1(void (*entry)(void));
+extern void multicore_reset_core1(void);
+
+#endif /* !PICO_MULTICORE_H */
@@ -0,0 +1,30 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: pico/stdlib.h
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+#include <stdio.h>
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+extern bool stdio_init_all(void);
+extern int putchar_raw(int c);
+
+/* terminates the program at the end of the input */
+extern int hal_getchar(void);
+#undef getchar
+#define getchar() hal_getchar()
+
+#endif /* !PICO_STDLIB_H */
@@ -0,0 +1,40 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: pico/time.h, time is taken from CLOCK_MONOTONIC and
+ * alarms are run in their own thread
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef PICO_TIME_H
+#define PICO_TIME_H
+
+#include "pico.h"
+
+typedef uint64_t absolute_time_t;
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+extern absolute_time_t get_absolute_time(void);
+extern void sleep_us(uint64_t us);
+extern void sleep_ms(uint32_t ms);
+extern alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback,
+				  void *user_data, bool fire_if_past);
+extern bool cancel_alarm(alarm_id_t id);
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+	return t;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from,
+					    absolute_time_t to)
+{
+	return (int64_t) (to - from);
+}
+
+#endif /* !PICO_TIME_H */
@@ -0,0 +1,64 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: replaces sd_card.h of no-OS-FatFS-SD-SDIO-SPI-RPi-Pico,
+ * the MicroSD card is an image file, implemented in sdimg.c
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SD_CARD_H
+#define SD_CARD_H
+
+#include "pico.h"
+#include "ff.h"
+#include "diskio.h"
+
+typedef enum { SD_IF_NONE, SD_IF_SPI, SD_IF_SDIO } sd_if_t;
+
+typedef enum {
+	SD_BLOCK_DEVICE_ERROR_NONE = 0,
+	SD_BLOCK_DEVICE_ERROR_PARAMETER = 1 << 2,
+	SD_BLOCK_DEVICE_ERROR_NO_INIT = 1 << 3,
+	SD_BLOCK_DEVICE_ERROR_NO_DEVICE = 1 << 4,
+	SD_BLOCK_DEVICE_ERROR_WRITE = 1 << 10
+} block_dev_err_t;
+
+typedef struct sd_sdio_if_t {
+	uint CMD_gpio;
+	uint D0_gpio;
+	uint baud_rate;
+} sd_sdio_if_t;
+
+typedef struct sd_card_state_t {
+	DSTATUS m_Status;
+} sd_card_state_t;
+
+typedef struct sd_card_t sd_card_t;
+
+struct sd_card_t {
+	sd_if_t type;
+	sd_sdio_if_t *sdio_if_p;
+	sd_card_state_t state;
+
+	block_dev_err_t (*write_blocks)(sd_card_t *sd_card_p,
+					const uint8_t *buffer,
+					uint32_t ulSectorNumber,
+					uint32_t blockCnt);
+	block_dev_err_t (*read_blocks)(sd_card_t *sd_card_p, uint8_t *buffer,
+				       uint32_t ulSectorNumber,
+				       uint32_t ulSectorCount);
+	uint32_t (*get_num_sectors)(sd_card_t *sd_card_p);
+
+	int fd;		/* host: file descriptor of the image */
+};
+
+extern bool sd_init_driver(void);
+
+static inline void sd_lock(sd_card_t *sd_card_p) { (void) sd_card_p; }
+static inline void sd_unlock(sd_card_t *sd_card_p) { (void) sd_card_p; }
+
+#endif /* !SD_CARD_H */
@@ -0,0 +1,132 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Create an image of a MicroSD card for the host build of picosim,
+ * with the directories CONF80, CODE80 and DISKS80. Files with the
+ * extension .bin, .com and .hex are copied into CODE80, files with .dsk
+ * into DISKS80 and .txt (batch scripts) into CONF80, file names are
+ * converted to upper case.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ * 19-OCT-2026 copy batch scripts into CONF80
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+
+#include "ff.h"
+#include "f_util.h"
+#include "hw_config.h"
+
+static sd_card_t sd_card = {
+	.type = SD_IF_SDIO
+};
+
+size_t sd_get_num(void)
+{
+	return 1;
+}
+
+sd_card_t *sd_get_by_num(size_t num)
+{
+	return (num == 0) ? &sd_card : NULL;
+}
+
+static void copy_file(const char *path, const char *dir)
+{
+	char name[FF_MAX_LFN + 1], *s, *base, *p;
+	static char buf[4096];
+	FILE *fp;
+	FIL fil;
+	FRESULT res;
+	size_t n;
+	UINT bw;
+
+	if ((p = strdup(path)) == NULL)
+		return;
+	base = basename(p);
+	snprintf(name, sizeof(name), "%s/%s", dir, base);
+	for (s = name; *s; s++)
+		*s = toupper((unsigned char) *s);
+	free(p);
+
+	if ((fp = fopen(path, "rb")) == NULL) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	if ((res = f_open(&fil, name, FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK) {
+		fprintf(stderr, "%s: %s\n", name, FRESULT_str(res));
+		exit(EXIT_FAILURE);
+	}
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		if ((res = f_write(&fil, buf, n, &bw)) != FR_OK || bw != n) {
+			fprintf(stderr, "%s: %s\n", name, FRESULT_str(res));
+			exit(EXIT_FAILURE);
+		}
+	f_close(&fil);
+	fclose(fp);
+	printf("%s -> %s\n", path, name);
+}
+
+int main(int argc, char *argv[])
+{
+	static const MKFS_PARM opt = { FM_FAT32, 0, 0, 0, 0 };
+	static BYTE work[FF_MAX_SS];
+	FATFS fs;
+	FRESULT res;
+	const char *ext;
+	long mb;
+	int fd, i;
+
+	if (argc < 3 || (mb = atol(argv[2])) < 64) {
+		fprintf(stderr, "usage: %s image size_in_MB (>= 64) "
+			"[file.bin|.com|.hex|.dsk|.txt ...]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* create the image file */
+	if ((fd = open(argv[1], O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1 ||
+	    ftruncate(fd, (off_t) mb * 1024 * 1024) == -1) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	close(fd);
+	setenv("PICOSIM_SDIMG", argv[1], 1);
+
+	/* create file system and directories */
+	if ((res = f_mkfs("", &opt, work, sizeof(work))) != FR_OK ||
+	    (res = f_mount(&fs, "", 1)) != FR_OK ||
+	    (res = f_mkdir("/CONF80")) != FR_OK ||
+	    (res = f_mkdir("/CODE80")) != FR_OK ||
+	    (res = f_mkdir("/DISKS80")) != FR_OK) {
+		fprintf(stderr, "%s: %s\n", argv[1], FRESULT_str(res));
+		return EXIT_FAILURE;
+	}
+
+	for (i = 3; i < argc; i++) {
+		if ((ext = strrchr(argv[i], '.')) == NULL)
+			ext = "";
+		if (strcasecmp(ext, ".bin") == 0 ||
+		    strcasecmp(ext, ".com") == 0 ||
+		    strcasecmp(ext, ".hex") == 0)
+			copy_file(argv[i], "/CODE80");
+		else if (strcasecmp(ext, ".dsk") == 0)
+			copy_file(argv[i], "/DISKS80");
+		else if (strcasecmp(ext, ".txt") == 0)
+			copy_file(argv[i], "/CONF80");
+		else
+			fprintf(stderr, "%s: skipped, unknown extension\n",
+				argv[i]);
+	}
+
+	f_unmount("");
+	return EXIT_SUCCESS;
+}
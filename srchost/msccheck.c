@@ -0,0 +1,178 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Check of the readahead and write gathering of the USB mass storage
+ * (libs/stdio_msc_usb/msc_cache.c) against an image of a MicroSD card.
+ * The READ10/WRITE10 callbacks are called like TinyUSB does, in pieces
+ * of the MSC transfer buffer size, with msc_cache_task() in between,
+ * where the USB controller would transfer data. A copy of the image is
+ * kept in memory and all data read is compared with it. The image is
+ * modified, use a scratch copy:
+ *
+ *	cp sdcard.img scratch.img
+ *	build-host/msccheck scratch.img
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "hw_config.h"
+#include "pico/time.h"
+#include "msc_cache.h"
+
+#define BLKSZ		512
+#define EP_BLOCKS	(4096 / BLKSZ)	/* CFG_TUD_MSC_EP_BUFSIZE */
+#define MAXCMD		128		/* max. blocks of a SCSI command */
+#define NRANDOM		5000		/* number of random commands */
+
+static sd_card_t sd_card;
+
+size_t sd_get_num(void)
+{
+	return 1;
+}
+
+sd_card_t *sd_get_by_num(size_t num)
+{
+	return (num == 0) ? &sd_card : NULL;
+}
+
+absolute_time_t get_absolute_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+static uint8_t *shadow;		/* copy of the image */
+static uint32_t nblocks;	/* size of the image in blocks */
+static unsigned long ncallbacks, nerrors;
+
+/*
+ * a READ10 command, split into callbacks like TinyUSB
+ */
+static void scsi_read(uint32_t lba, uint32_t cnt)
+{
+	static uint8_t buf[EP_BLOCKS * BLKSZ];
+	uint32_t n;
+	int32_t len;
+
+	while (cnt > 0) {
+		n = (cnt > EP_BLOCKS) ? EP_BLOCKS : cnt;
+		ncallbacks++;
+		len = msc_cache_read(&sd_card, lba, buf, n);
+		if (len != (int32_t) (n * BLKSZ) ||
+		    memcmp(buf, &shadow[(size_t) lba * BLKSZ], n * BLKSZ)) {
+			fprintf(stderr, "read error at block %u\n", lba);
+			nerrors++;
+		}
+		msc_cache_task(&sd_card, true);
+		lba += n;
+		cnt -= n;
+	}
+}
+
+/*
+ * a WRITE10 command with random data
+ */
+static void scsi_write(uint32_t lba, uint32_t cnt)
+{
+	static uint8_t buf[EP_BLOCKS * BLKSZ];
+	uint32_t n, i;
+
+	while (cnt > 0) {
+		n = (cnt > EP_BLOCKS) ? EP_BLOCKS : cnt;
+		for (i = 0; i < n * BLKSZ; i++)
+			buf[i] = (uint8_t) rand();
+		memcpy(&shadow[(size_t) lba * BLKSZ], buf, n * BLKSZ);
+		ncallbacks++;
+		if (msc_cache_write(&sd_card, lba, buf, n) !=
+		    (int32_t) (n * BLKSZ)) {
+			fprintf(stderr, "write error at block %u\n", lba);
+			nerrors++;
+		}
+		msc_cache_task(&sd_card, true);
+		lba += n;
+		cnt -= n;
+	}
+}
+
+static uint32_t rand_lba(uint32_t cnt)
+{
+	return (uint32_t) ((unsigned long) rand() % (nblocks - cnt));
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t lba, cnt, i;
+	size_t size;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s scratch_image\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	setenv("PICOSIM_SDIMG", argv[1], 1);
+	if (disk_initialize(0) != 0)
+		return EXIT_FAILURE;
+
+	nblocks = sd_card.get_num_sectors(&sd_card);
+	size = (size_t) nblocks * BLKSZ;
+	if (nblocks < 32768 + MAXCMD || (shadow = malloc(size)) == NULL ||
+	    sd_card.read_blocks(&sd_card, shadow, 0, nblocks) !=
+	    SD_BLOCK_DEVICE_ERROR_NONE) {
+		fprintf(stderr, "%s: can't read image\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	srand(1);
+
+	/* copy files to the PC */
+	for (lba = 0; lba + MAXCMD <= nblocks && lba < 16384; lba += MAXCMD)
+		scsi_read(lba, MAXCMD);
+	/* copy files from the PC */
+	for (lba = 16384; lba + MAXCMD <= nblocks && lba < 32768;
+	     lba += MAXCMD)
+		scsi_write(lba, MAXCMD);
+	/* FAT updates, directory reads, reads of pending writes */
+	for (i = 0; i < NRANDOM; i++) {
+		cnt = 1 + (uint32_t) rand() % MAXCMD;
+		if (rand() & 1) {
+			lba = (rand() & 1) ? rand_lba(cnt) :
+			      16384 + (uint32_t) rand() % 16384;
+			scsi_read(lba, cnt);
+		} else
+			scsi_write(rand_lba(cnt), cnt);
+	}
+	if (!msc_cache_flush(&sd_card))
+		nerrors++;
+
+	/* the image must be the copy now */
+	for (lba = 0; lba < nblocks; lba += MAXCMD) {
+		static uint8_t buf[MAXCMD * BLKSZ];
+
+		cnt = (nblocks - lba > MAXCMD) ? MAXCMD : nblocks - lba;
+		sd_card.read_blocks(&sd_card, buf, lba, cnt);
+		if (memcmp(buf, &shadow[(size_t) lba * BLKSZ], cnt * BLKSZ)) {
+			fprintf(stderr, "image differs at block %u\n", lba);
+			nerrors++;
+			break;
+		}
+	}
+
+	printf("msccheck callbacks=%lu sd_reads=%u sd_writes=%u ra_hits=%u "
+	       "wr_gathered=%u errors=%lu\n", ncallbacks,
+	       msc_cache_stats.sd_reads, msc_cache_stats.sd_writes,
+	       msc_cache_stats.ra_hits, msc_cache_stats.wr_gathered,
+	       nerrors);
+	return nerrors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
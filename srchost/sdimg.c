@@ -0,0 +1,176 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: the MicroSD card is an image file with a FAT file system,
+ * FatFS accesses it through the sd_card_t block functions, like on
+ * the Pico. The name of the image is taken from the environment
+ * variable PICOSIM_SDIMG, default is sdcard.img. The blocks read and
+ * written are counted in sdimg_stats.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "hw_config.h"
+#include "my_rtc.h"
+#include "sdimg.h"
+
+#define BLKSZ 512
+
+struct sdimg_stats sdimg_stats;
+
+static block_dev_err_t img_read_blocks(sd_card_t *sd_card_p, uint8_t *buffer,
+				       uint32_t ulSectorNumber,
+				       uint32_t ulSectorCount)
+{
+	size_t len = (size_t) ulSectorCount * BLKSZ;
+
+	sdimg_stats.rd_cmds++;
+	sdimg_stats.rd_blks += ulSectorCount;
+	if (pread(sd_card_p->fd, buffer, len, (off_t) ulSectorNumber * BLKSZ)
+	    != (ssize_t) len)
+		return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+	return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static block_dev_err_t img_write_blocks(sd_card_t *sd_card_p,
+					const uint8_t *buffer,
+					uint32_t ulSectorNumber,
+					uint32_t blockCnt)
+{
+	size_t len = (size_t) blockCnt * BLKSZ;
+
+	sdimg_stats.wr_cmds++;
+	sdimg_stats.wr_blks += blockCnt;
+	if (pwrite(sd_card_p->fd, buffer, len, (off_t) ulSectorNumber * BLKSZ)
+	    != (ssize_t) len)
+		return SD_BLOCK_DEVICE_ERROR_WRITE;
+	return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static uint32_t img_get_num_sectors(sd_card_t *sd_card_p)
+{
+	struct stat st;
+
+	if (fstat(sd_card_p->fd, &st) == -1)
+		return 0;
+	return (uint32_t) (st.st_size / BLKSZ);
+}
+
+bool sd_init_driver(void)
+{
+	return true;
+}
+
+/*
+ * FatFS disk I/O functions
+ */
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+	sd_card_t *sd_card_p = sd_get_by_num(pdrv);
+	const char *name;
+
+	if (sd_card_p == NULL)
+		return STA_NOINIT;
+	if (sd_card_p->read_blocks != NULL)
+		return 0;
+
+	if ((name = getenv("PICOSIM_SDIMG")) == NULL)
+		name = "sdcard.img";
+	if ((sd_card_p->fd = open(name, O_RDWR)) == -1) {
+		perror(name);
+		return STA_NOINIT | STA_NODISK;
+	}
+	sd_card_p->read_blocks = img_read_blocks;
+	sd_card_p->write_blocks = img_write_blocks;
+	sd_card_p->get_num_sectors = img_get_num_sectors;
+	return 0;
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+	sd_card_t *sd_card_p = sd_get_by_num(pdrv);
+
+	if (sd_card_p == NULL || sd_card_p->read_blocks == NULL)
+		return STA_NOINIT;
+	return 0;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+	sd_card_t *sd_card_p = sd_get_by_num(pdrv);
+
+	if (disk_status(pdrv))
+		return RES_NOTRDY;
+	return sd_card_p->read_blocks(sd_card_p, buff, (uint32_t) sector,
+				      count) == SD_BLOCK_DEVICE_ERROR_NONE ?
+		RES_OK : RES_ERROR;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+	sd_card_t *sd_card_p = sd_get_by_num(pdrv);
+
+	if (disk_status(pdrv))
+		return RES_NOTRDY;
+	return sd_card_p->write_blocks(sd_card_p, buff, (uint32_t) sector,
+				       count) == SD_BLOCK_DEVICE_ERROR_NONE ?
+		RES_OK : RES_ERROR;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+	sd_card_t *sd_card_p = sd_get_by_num(pdrv);
+
+	if (disk_status(pdrv))
+		return RES_NOTRDY;
+
+	switch (cmd) {
+	case CTRL_SYNC:
+		return fsync(sd_card_p->fd) == 0 ? RES_OK : RES_ERROR;
+	case GET_SECTOR_COUNT:
+		*(LBA_t *) buff = sd_card_p->get_num_sectors(sd_card_p);
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD *) buff = BLKSZ;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD *) buff = 1;
+		return RES_OK;
+	default:
+		return RES_PARERR;
+	}
+}
+
+/*
+ * FatFS time stamps from the host clock
+ */
+DWORD get_fattime(void)
+{
+	time_t now = time(NULL);
+	struct tm *t = localtime(&now);
+
+	return ((DWORD) (t->tm_year - 80) << 25) |
+	       ((DWORD) (t->tm_mon + 1) << 21) |
+	       ((DWORD) t->tm_mday << 16) |
+	       ((DWORD) t->tm_hour << 11) |
+	       ((DWORD) t->tm_min << 5) |
+	       ((DWORD) t->tm_sec >> 1);
+}
+
+void time_init(void)
+{
+}
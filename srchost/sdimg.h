@@ -0,0 +1,25 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Host HAL: statistics of the I/O to the image of the MicroSD card,
+ * counted in the sd_card_t block functions of sdimg.c.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SDIMG_INC
+#define SDIMG_INC
+
+struct sdimg_stats {
+	unsigned long rd_cmds;	/* read_blocks() calls */
+	unsigned long rd_blks;	/* 512 byte blocks read */
+	unsigned long wr_cmds;	/* write_blocks() calls */
+	unsigned long wr_blks;	/* 512 byte blocks written */
+};
+
+extern struct sdimg_stats sdimg_stats;
+
+#endif /* !SDIMG_INC */
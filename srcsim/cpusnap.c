@@ -0,0 +1,63 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Snapshot of the CPU registers, published by the CPU on core 0
+ * and read by the LCD task on core 1, see cpusnap.h.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include "pico.h"
+
+#include "cpusnap.h"
+
+volatile uint32_t cpu_snap_seq;	/* odd while the snapshot is written */
+struct cpu_snap cpu_snap_buf;	/* last published registers */
+Tstates_t cpu_snap_T;		/* T states at the last snapshot */
+
+/*
+ *	copy the registers as they are now, consistent only on core 0
+ *	between instructions
+ */
+void __not_in_flash_func(cpu_snap_live)(struct cpu_snap *s)
+{
+	s->t = T;
+	s->pc = PC;
+	s->sp = SP;
+	s->a = A;
+	s->f = F;
+	s->b = B;
+	s->c = C;
+	s->d = D;
+	s->e = E;
+	s->h = H;
+	s->l = L;
+}
+
+/*
+ *	get the last published snapshot, returns false if there is
+ *	none or the CPU kept writing it
+ */
+bool __not_in_flash_func(cpu_snap_get)(struct cpu_snap *s)
+{
+	uint32_t seq;
+	int tries = 3;
+
+	do {
+		seq = cpu_snap_seq;
+		if (seq == 0)
+			return false;
+		if (seq & 1)
+			continue;
+		__dmb();
+		*s = cpu_snap_buf;
+		__dmb();
+		if (cpu_snap_seq == seq)
+			return true;
+	} while (--tries > 0);
+
+	return false;
+}
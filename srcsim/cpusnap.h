@@ -0,0 +1,61 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Consistent snapshot of the CPU registers for core 1. The CPU on
+ * core 0 publishes the registers between instructions, at most once
+ * per tmax T states, guarded by a sequence counter: it is odd while
+ * the snapshot is written, a reader retries if it was odd or changed
+ * while reading.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef CPUSNAP_INC
+#define CPUSNAP_INC
+
+#include "hardware/sync.h"
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+
+struct cpu_snap {
+	Tstates_t t;		/* T states at the snapshot */
+	WORD pc, sp;
+	BYTE a, f, b, c, d, e, h, l;
+};
+
+extern volatile uint32_t cpu_snap_seq;
+extern struct cpu_snap cpu_snap_buf;
+extern Tstates_t cpu_snap_T;
+
+extern bool cpu_snap_get(struct cpu_snap *s);
+extern void cpu_snap_live(struct cpu_snap *s);
+
+/*
+ *	publish the registers, core 0 only
+ */
+static inline void cpu_snap_publish(void)
+{
+	cpu_snap_seq++;
+	__dmb();
+	cpu_snap_live(&cpu_snap_buf);
+	__dmb();
+	cpu_snap_seq++;
+	cpu_snap_T = T;
+}
+
+/*
+ *	publish the registers if tmax T states passed since the last
+ *	snapshot, called between instructions, e.g. from the I/O ports
+ */
+static inline void cpu_snap_tick(void)
+{
+	if (T - cpu_snap_T >= (Tstates_t) tmax)
+		cpu_snap_publish();
+}
+
+#endif /* !CPUSNAP_INC */
@@ -3,6 +3,9 @@
  *
  * Copyright (C) 2015-2024 by Udo Munk
  * Copyright (C) 2024 by Thomas Eberhardt
+ *
+ * History:
+ * 19-OCT-2026 frame flags from the emulated time, not from the LCD
  */
 
 #include <stdint.h>
@@ -114,9 +117,24 @@ static const uint8_t dazzler[] = {
 /* DAZZLER stuff */
 int dazzler_state;
 static WORD dma_addr;
-static BYTE flags = 64;
 static BYTE format;
 
+/*
+ * The Dazzler shows 60 frames per second with 262 lines each. The
+ * end of frame flag (bit 6) is low for 4ms after a frame, the odd
+ * line flag (bit 7) is low on odd lines. Both are computed from the
+ * emulated T states with the speed of the CPU, or from the real time
+ * if the speed is not limited, so the guest sees real Dazzler frames
+ * however long drawing them on the LCD takes.
+ */
+#define FRAME_US	16667	/* one frame */
+#define EOF_US		4000	/* end of frame flag low */
+#define LINE_NS		63613	/* one line, 262 per frame */
+
+static int frame_f = -1;		/* speed the times were computed for */
+static uint32_t frame_len, frame_eof, line_len; /* in T states or us */
+static uint64_t frame_start;		/* start of the actual frame */
+
 /* centered image on 480x320 LCD */
 #define XOFF 160
 #define YOFF 96
@@ -297,11 +315,6 @@ void __not_in_flash_func(dazzler_draw)(void)
 		draw_hires();
 	else
 		draw_lowres();
-
-	/* frame done, set frame flag for 4ms */
-	flags = 0;
-	sleep_ms(4);
-	flags = 64;
 }
 
 void dazzler_ctl_out(BYTE data)
@@ -325,6 +338,32 @@ void dazzler_ctl_out(BYTE data)
 
 BYTE dazzler_flags_in(void)
 {
+	uint64_t now;
+	uint32_t pos;
+	BYTE flags = 0;
+
+	/* T states per microsecond, 1 for the real time */
+	if (f_value != frame_f) {
+		frame_f = f_value;
+		pos = f_value ? f_value : 1;
+		frame_len = FRAME_US * pos;
+		frame_eof = (FRAME_US - EOF_US) * pos;
+		line_len = LINE_NS * pos / 1000;
+		frame_start = 0;
+	}
+	now = f_value ? T : get_clock_us();
+
+	/* frames passed since the last poll */
+	if (now - frame_start >= 2 * (uint64_t) frame_len)
+		frame_start = now - (now - frame_start) % frame_len;
+	else if (now - frame_start >= frame_len)
+		frame_start += frame_len;
+	pos = (uint32_t) (now - frame_start);
+
+	if (pos < frame_eof)
+		flags |= 64;
+	if (!((pos / line_len) & 1))	/* low on odd lines */
+		flags |= 128;
 	return flags;
 }
 
@@ -332,3 +371,13 @@ void dazzler_format_out(BYTE data)
 {
 	format = data;
 }
+
+/*
+ * values written last to the control and format port,
+ * writing them again restores the state of the Dazzler
+ */
+void dazzler_get_state(BYTE *ctl, BYTE *fmt)
+{
+	*ctl = (dma_addr >> 9) | (dazzler_state ? 128 : 0);
+	*fmt = format;
+}
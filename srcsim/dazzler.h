@@ -14,6 +14,7 @@
 extern void dazzler_ctl_out(BYTE data), dazzler_format_out(BYTE data);
 extern void dazzler_draw(void);
 extern BYTE dazzler_flags_in(void);
+extern void dazzler_get_state(BYTE *ctl, BYTE *fmt);
 extern volatile bool first_flag;
 extern int dazzler_state;
 
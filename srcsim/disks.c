@@ -11,48 +11,152 @@
  * 28-MAY-2024 implemented sector I/O to disk images
  * 03-JUN-2024 added directory list for code files and disk images
  * 29-JUN-2024 split of from memsim.c and picosim.c
+ * 19-OCT-2026 bypass FatFS for sector I/O on contiguous disk images
+ * 19-OCT-2026 keep a disk image in RAM on RP2350
+ * 19-OCT-2026 per drive geometry, support 4 MB and 8 MB hard disk images
+ * 19-OCT-2026 optional trace of all sector requests
+ * 19-OCT-2026 read the system tracks of drive 0 with one request at boot
+ * 19-OCT-2026 load files with one read, load address, .COM and .HEX files
+ * 19-OCT-2026 sorted in RAM index of the directories CODE80 and DISKS80
+ * 19-OCT-2026 FDC has priority over USB mass storage
+ * 19-OCT-2026 SDIO clock derived from the actual system clock
+ * 19-OCT-2026 RAM disk write back retried after errors
+ * 19-OCT-2026 all MicroSD I/O has priority over USB mass storage
+ * 19-OCT-2026 remember the address of the FDC command block
  */
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "sim.h"
 #include "simdefs.h"
 #include "simglb.h"
 #include "simmem.h"
+#include "simport.h"
 
 #include "f_util.h"
 #include "ff.h"
 #include "hw_config.h"
+#include "hardware/clocks.h"
+#if LIB_STDIO_MSC_USB
+#include "diskio.h"
+#include "stdio_msc_usb.h"
+#endif
 
 #include "sd-fdc.h"
 #include "disks.h"
 #include "rgbled.h"
+#ifdef DISKTRACE
+#include "dsktrace.h"
+#endif
 
 FIL sd_file;	/* at any time we have only one file open */
 FRESULT sd_res;	/* result code from FatFS */
 char disks[NUMDISK][DISKLEN+1]; /* path name for 4 disk images /DISKS80/filename.DSK */
+int ramdisk = -1;	/* drive kept in RAM, -1 = none */
+int ramdisk_flush = 5;	/* seconds until dirty tracks are written back */
+int fdc_cmd_addr = -1;	/* address of the last FDC command, -1 = none */
 
 static FATFS fs; /* FatFs on MicroSD */
 
 /* buffer for disk/memory transfers */
-static unsigned char __aligned(4) dsk_buf[SEC_SZ];
+static unsigned char __aligned(4) dsk_buf[HDSEC_SZ];
+
+/* disk geometries, selected by the size of the disk image */
+static const struct {
+	FSIZE_t size;	/* size of image in bytes */
+	int trk;	/* number of tracks */
+	int spt;	/* sectors per track */
+	int secsz;	/* sector size in bytes */
+} dsk_geom[] = {
+	{ (FSIZE_t) TRK * SPT * SEC_SZ, TRK, SPT, SEC_SZ }, /* 8" SSSD */
+	{ 4 * 1024 * 1024, 256, 32, HDSEC_SZ },	/* 4 MB hard disk */
+	{ 8 * 1024 * 1024, 256, 64, HDSEC_SZ }	/* 8 MB hard disk */
+};
+#define NUMGEOM	(sizeof(dsk_geom) / sizeof(dsk_geom[0]))
+
+/* mapping of the disk images on MicroSD */
+static struct {
+	FSIZE_t size;	/* size of image in bytes, 0 = not mapped yet */
+	LBA_t lba;	/* first block of contiguous image, 0 = use FatFS */
+	int geom;	/* index into dsk_geom */
+} dsk_map[NUMDISK];
+
+/* one block cache for raw access to contiguous disk images */
+static LBA_t blk_lba;	/* block in blk_buf, 0 = invalid */
+static unsigned char __aligned(4) blk_buf[FF_MAX_SS];
+
+#ifdef RAMDISK
+#define RAM_TRKSZ (SPT * SEC_SZ)	/* bytes per track */
+
+/* disk image in RAM */
+static unsigned char __aligned(4) ram_dsk[TRK * RAM_TRKSZ];
+static int ram_drive = -1;		/* drive in RAM, -1 = none */
+static char ram_name[DISKLEN+1];	/* file name of image in RAM */
+static FSIZE_t ram_size;		/* size of image, 0 = doesn't fit */
+static bool ram_dirty[TRK];		/* tracks modified in RAM */
+static uint64_t ram_dirty_t;		/* time of first modification */
+
+static bool ram_flush(void);
+#endif
+
+#if BOOT_TRKS > 0
+#define BOOT_SZ (BOOT_TRKS * SPT * SEC_SZ)	/* bytes in system tracks */
+#define BOOT_BLKS ((BOOT_SZ + FF_MAX_SS - 1) / FF_MAX_SS) /* blocks read */
+
+/* system tracks of the 8" disk in drive 0, loaded when the boot sector
+   is read and used for all following reads of these tracks, also for
+   reloading the OS at warm boot */
+static unsigned char __aligned(4) boot_buf[BOOT_BLKS * FF_MAX_SS];
+static bool boot_valid;
+#endif
+
+/* sorted index of the directories with code files and disk images */
+#define DIRMAX	128		/* max. files in an index */
+#define DIRNAMELEN 12		/* max. length of a file name, 8.3 */
+#define DIRNONE	-1		/* value of n if not read yet */
+#define DIROVFL	(DIRMAX + 1)	/* value of n if too many files */
+
+static struct dir_index {
+	const char *path;	/* directory */
+	int n;			/* number of files */
+	char names[DIRMAX][DIRNAMELEN+1];
+} dir_idx[] = {
+	{ "/CODE80", DIRNONE, { "" } },
+	{ "/DISKS80", DIRNONE, { "" } }
+};
+#define NUMDIR	(sizeof(dir_idx) / sizeof(dir_idx[0]))
+
+static struct dir_index *dir_get(const char *dir);
+static void dir_invalidate(void);
+
+#ifdef DISKTRACE
+#define TRACE_N	512			/* records in the trace buffer */
+
+/* sector requests not yet written to the trace file */
+static struct dsktrace_rec trace_buf[TRACE_N];
+static int trace_n;			/* records in trace_buf */
+static uint64_t trace_t0;		/* time of first request, 0 = none */
+static bool trace_new = true;		/* create new trace file */
+
+static void trace_flush(void);
+#endif
+
+/* how prep_io() has set up the sector transfer */
+enum io_mode { IO_FATFS, IO_RAW, IO_RAM };
 
 /* global variables for access to MicroSD card */
 
 /* SDIO Interface */
+#define SD_MAX_HZ (21 * 1000 * 1000)	/* max. SDIO clock used */
+
 static sd_sdio_if_t sdio_if = {
 	.CMD_gpio = 18,
-	.D0_gpio = 19,
-#if PICO_RP2040
-	.baud_rate = 125 * 1000 * 1000 / 6	/* 20.833333 MHz */
-	//.baud_rate = 200 * 1000 * 1000 / 8	/* 25.00 MHz */
-#endif
-#if PICO_RP2350
-	.baud_rate = 150 * 1000 * 1000 / 8	/* 18.75 MHz */
-#endif
+	.D0_gpio = 19
+	/* .baud_rate is set from clk_sys in init_disks() */
 };
 
 /* Configuration of the SD Card socket object */
@@ -77,20 +181,180 @@ sd_card_t *sd_get_by_num(size_t num)
 	}
 }
 
+#if LIB_STDIO_MSC_USB
+/*
+ * All FatFS I/O to the MicroSD goes through these wrappers of the disk
+ * functions of the SD library, linked with --wrap, see CMakeLists.txt.
+ * The USB mass storage reads the card without FatFS, it drops its
+ * readahead and reads slower for a while, so that the application
+ * has priority and the USB host doesn't see stale blocks.
+ */
+extern DRESULT __real_disk_read(BYTE pdrv, BYTE *buff, LBA_t sector,
+				UINT count);
+extern DRESULT __real_disk_write(BYTE pdrv, const BYTE *buff,
+				 LBA_t sector, UINT count);
+
+DRESULT __wrap_disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+	stdio_msc_usb_app_sd_access();
+	return __real_disk_read(pdrv, buff, sector, count);
+}
+
+DRESULT __wrap_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector,
+			  UINT count)
+{
+	stdio_msc_usb_app_sd_access();
+	return __real_disk_write(pdrv, buff, sector, count);
+}
+#endif
+
+/*
+ * SDIO clock: clk_sys divided by the next even number, which gives
+ * a clock <= SD_MAX_HZ, e.g. 20.83 MHz from 125 MHz, 18.75 MHz from
+ * 150 MHz, 20 MHz from 200 MHz and 20.83 MHz from 250 MHz.
+ */
+static uint sd_baud_rate(void)
+{
+	uint32_t hz = clock_get_hz(clk_sys);
+	uint32_t n = (hz + SD_MAX_HZ - 1) / SD_MAX_HZ;
+
+	return hz / ((n + 1) & ~1U);
+}
+
 void init_disks(void)
 {
+	uint baud = sd_baud_rate();
+
+	/* initialize the card again if the system clock was changed */
+	if (sdio_if.baud_rate != baud) {
+		sdio_if.baud_rate = baud;
+		sd_card.state.m_Status |= STA_NOINIT;
+	}
+
 	/* try to mount SD card */
 	sd_res = f_mount(&fs, "", 1);
 	if (sd_res != FR_OK)
 		panic("f_mount error: %s (%d)\n", FRESULT_str(sd_res), sd_res);
+
+	/* read the directories now, so that the config dialog is fast */
+	dir_get("/CODE80");
+	dir_get("/DISKS80");
 }
 
 void exit_disks(void)
 {
+	register int i;
+
+	/* forget mappings, files might be changed while unmounted */
+	for (i = 0; i < NUMDISK; i++)
+		dsk_map[i].size = 0;
+	blk_lba = 0;
+#if BOOT_TRKS > 0
+	boot_valid = false;
+#endif
+	dir_invalidate();
+#ifdef RAMDISK
+	/* keep the modified tracks in RAM, if they can't be written */
+	if (ram_flush())
+		ram_drive = -1;
+	else
+		puts("RAM disk kept, write back tried again later");
+#endif
+#ifdef DISKTRACE
+	trace_flush();
+#endif
+
 	/* unmount SD card */
 	f_unmount("");
 }
 
+/*
+ * match file name 'name' against pattern 'pat' with * and ?,
+ * ignoring case like FatFS does
+ */
+static bool name_match(const char *name, const char *pat)
+{
+	while (*pat) {
+		if (*pat == '*') {
+			while (*pat == '*')
+				pat++;
+			if (*pat == '\0')
+				return true;
+			for (; *name; name++)
+				if (name_match(name, pat))
+					return true;
+			return false;
+		}
+		if (*name == '\0' || (*pat != '?' &&
+		    toupper((unsigned char) *pat) !=
+		    toupper((unsigned char) *name)))
+			return false;
+		pat++;
+		name++;
+	}
+	return *name == '\0';
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+	return strcmp((const char *) a, (const char *) b);
+}
+
+/*
+ * read the directory of a directory index and sort the names
+ */
+static void dir_read(struct dir_index *d)
+{
+	DIR dp;
+	FILINFO fno;
+
+	d->n = 0;
+	if (f_opendir(&dp, d->path) != FR_OK)
+		return;
+	while (f_readdir(&dp, &fno) == FR_OK && fno.fname[0]) {
+		/* only files which can be used by the machine */
+		if ((fno.fattrib & (AM_DIR | AM_HID | AM_SYS)) ||
+		    strlen(fno.fname) > DIRNAMELEN)
+			continue;
+		if (d->n == DIRMAX) {
+			d->n = DIROVFL;
+			break;
+		}
+		strcpy(d->names[d->n++], fno.fname);
+	}
+	f_closedir(&dp);
+	if (d->n != DIROVFL)
+		qsort(d->names, d->n, sizeof(d->names[0]), name_cmp);
+}
+
+/*
+ * get the directory index for 'dir', read it if necessary,
+ * returns NULL if there is none or the directory doesn't fit
+ */
+static struct dir_index *dir_get(const char *dir)
+{
+	register unsigned int i;
+
+	for (i = 0; i < NUMDIR; i++)
+		if (strcmp(dir_idx[i].path, dir) == 0) {
+			if (dir_idx[i].n == DIRNONE)
+				dir_read(&dir_idx[i]);
+			return (dir_idx[i].n == DIROVFL) ? NULL : &dir_idx[i];
+		}
+	return NULL;
+}
+
+/*
+ * forget the directory indexes, the card might be changed
+ */
+static void dir_invalidate(void)
+{
+	register unsigned int i;
+
+	for (i = 0; i < NUMDIR; i++)
+		dir_idx[i].n = DIRNONE;
+}
+
 /*
  * list files with pattern 'ext' in directory 'dir'
  */
@@ -99,19 +363,35 @@ void list_files(const char *dir, const char *ext)
 	DIR dp;
 	FILINFO fno;
 	FRESULT res;
+	struct dir_index *d;
 	int cols = 80 / (FNLEN + 8) - 1;
-	register int i = 0;
+	register int i = 0, j;
 
 	/* convert to string */
 	#define STR_(X) #X
 	/* this makes sure the argument is expanded before converting to string */
 	#define STR(X) STR_(X)
 
+	if ((d = dir_get(dir)) != NULL) {
+		for (j = 0; j < d->n; j++) {
+			if (!name_match(d->names[j], ext))
+				continue;
+			printf("%-" STR(FNLEN) "s\t", d->names[j]);
+			if (++i > cols) {
+				putchar('\n');
+				i = 0;
+			}
+		}
+		if (i > 0)
+			putchar('\n');
+		return;
+	}
+
 	res = f_findfirst(&dp, &fno, dir, ext);
 	if (res == FR_OK) {
 		while (1) {
 			printf("%-" STR(FNLEN) "s\t", fno.fname);
-			if (i > cols) {
+			if (++i > cols) {
 				putchar('\n');
 				i = 0;
 			}
@@ -126,42 +406,183 @@ void list_files(const char *dir, const char *ext)
 }
 
 /*
- * load a file 'name' into memory
- * returns true on success, false on error
+ * find files matching pattern 'ext' in directory 'dir', whose name
+ * starts with 'prefix', the name without extension of the first match
+ * is returned in name, a file named 'prefix' is the only match,
+ * returns the number of matches or -1 if the directory isn't indexed
  */
-bool load_file(const char *name)
+int find_files(const char *dir, const char *ext, const char *prefix,
+	       char *name)
 {
-	int i = 0;
-	bool res;
-	register unsigned int j;
+	struct dir_index *d;
+	size_t len = strlen(prefix);
+	register int j, n = 0;
+	bool exact;
+	char *s;
+
+	if ((d = dir_get(dir)) == NULL)
+		return -1;
+
+	for (j = 0; j < d->n; j++) {
+		if (!name_match(d->names[j], ext) ||
+		    strncasecmp(d->names[j], prefix, len) != 0)
+			continue;
+		exact = d->names[j][len] == '.' || d->names[j][len] == '\0';
+		if (exact || n == 0) {
+			strncpy(name, d->names[j], FNLEN);
+			name[FNLEN] = '\0';
+			if ((s = strchr(name, '.')) != NULL)
+				*s = '\0';
+		}
+		if (exact)
+			return 1;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * load a binary file into memory @ addr with one read, so that FatFS
+ * can transfer it with multi block reads directly into the memory bank
+ */
+static bool load_bin(const char *fn, WORD addr)
+{
+	FSIZE_t size = f_size(&sd_file);
+	unsigned int top = selbnk ? 0xc000 : 0xff00;
 	unsigned int br;
-	char SFN[DISKLEN+1];
 
-	strcpy(SFN, "/CODE80/");
-	strcat(SFN, name);
-	strcat(SFN, ".BIN");
+	/* neither the boot ROM nor the common segment from bank 1 */
+	if (addr + size > top) {
+		printf("File doesn't fit between %04XH and %04XH\n",
+		       addr, top - 1);
+		return false;
+	}
 
-	/* try to open file */
-	sd_res = f_open(&sd_file, SFN, FA_READ);
-	if (sd_res != FR_OK) {
-		puts("File not found");
+	sd_res = f_read(&sd_file, selbnk ? &bnk1[addr] : &bnk0[addr],
+			(UINT) size, &br);
+	if (sd_res != FR_OK || br != size) {
+		printf("f_read error: %s (%d)\n", FRESULT_str(sd_res), sd_res);
 		return false;
 	}
+	printf("loaded file \"%s\" at %04XH (%u bytes)\n", fn, addr, br);
+	return true;
+}
+
+/*
+ * convert two hex digits, returns -1 if invalid
+ */
+static int hex_byte(const char *s)
+{
+	int i, n = 0;
+
+	for (i = 0; i < 2; i++, s++) {
+		n <<= 4;
+		if (*s >= '0' && *s <= '9')
+			n += *s - '0';
+		else if (*s >= 'A' && *s <= 'F')
+			n += *s - 'A' + 10;
+		else if (*s >= 'a' && *s <= 'f')
+			n += *s - 'a' + 10;
+		else
+			return -1;
+	}
+	return n;
+}
+
+/*
+ * load an Intel HEX file into memory, the start address is taken
+ * from the end of file record, or the first data record if it is 0
+ */
+static bool load_hex(const char *fn, WORD *start)
+{
+	char line[80], *p;
+	int len, addr, type, sum, b, i, n = 0;
+	int lineno = 0, first = -1;
+	unsigned int top = selbnk ? 0xc000 : 0xff00;
+	BYTE *mem = selbnk ? bnk1 : bnk0;
+
+	while (f_gets(line, sizeof(line), &sd_file) != NULL) {
+		lineno++;
+		if (line[0] != ':')
+			continue;
+		p = &line[1];
+		if ((len = hex_byte(p)) < 0 || (addr = hex_byte(p + 2)) < 0 ||
+		    (b = hex_byte(p + 4)) < 0 || (type = hex_byte(p + 6)) < 0)
+			goto bad;
+		sum = len + addr + b + type;
+		addr = (addr << 8) | b;
+		p += 8;
+		for (i = 0; i < len; i++, p += 2) {
+			if ((b = hex_byte(p)) < 0)
+				goto bad;
+			sum += b;
+			if (type != 0)
+				continue;
+			if (addr + i >= (int) top) {
+				printf("Record in line %d beyond %04XH\n",
+				       lineno, top - 1);
+				return false;
+			}
+			mem[addr + i] = b;
+		}
+		if ((b = hex_byte(p)) < 0 || ((sum + b) & 0xff) != 0)
+			goto bad;
+		if (type == 0) {
+			if (first < 0 && len > 0)
+				first = addr;
+			n += len;
+		} else if (type == 1) {
+			if (addr != 0 || first < 0)
+				first = addr;
+			break;
+		}
+	}
+	if (start != NULL)
+		*start = (first < 0) ? 0 : first;
+	printf("loaded file \"%s\" (%d bytes)\n", fn, n);
+	return true;
 
-	/* read file into memory */
-	while ((sd_res = f_read(&sd_file, dsk_buf, SEC_SZ, &br)) == FR_OK) {
-		for (j = 0; j < br; j++)
-			dma_write(i + j, dsk_buf[j]);
-		if (br < SEC_SZ)	/* last record reached */
+bad:
+	printf("Invalid record in line %d\n", lineno);
+	return false;
+}
+
+/*
+ * load a file 'name' from /CODE80 into the selected memory bank,
+ * the file is searched with the extensions .BIN, .COM and .HEX:
+ *	.BIN	binary loaded @ addr, 0000H if addr < 0
+ *	.COM	binary loaded @ addr, 0100H if addr < 0
+ *	.HEX	Intel HEX, loaded @ the addresses of the records
+ * returns true on success and the start address of the
+ * program in start, if not NULL, false on error
+ */
+bool load_file(const char *name, int addr, WORD *start)
+{
+	static const char *const ext[] = { ".BIN", ".COM", ".HEX" };
+	register unsigned int i;
+	bool res;
+	char SFN[DISKLEN+1];
+
+	for (i = 0; i < sizeof(ext) / sizeof(ext[0]); i++) {
+		strcpy(SFN, "/CODE80/");
+		strcat(SFN, name);
+		strcat(SFN, ext[i]);
+		if ((sd_res = f_open(&sd_file, SFN, FA_READ)) == FR_OK)
 			break;
-		i += SEC_SZ;
 	}
 	if (sd_res != FR_OK) {
-		printf("f_read error: %s (%d)\n", FRESULT_str(sd_res), sd_res);
-		res = false;
-	} else {
-		printf("loaded file \"%s\" (%d bytes)\n", SFN, i + br);
-		res = true;
+		puts("File not found");
+		return false;
+	}
+
+	if (i == 2)
+		res = load_hex(SFN, start);
+	else {
+		if (addr < 0)
+			addr = (i == 1) ? 0x0100 : 0x0000;
+		res = load_bin(SFN, addr);
+		if (res && start != NULL)
+			*start = addr;
 	}
 
 	f_close(&sd_file);
@@ -219,34 +640,284 @@ void mount_disk(int drive, const char *name)
 	}
 
 	f_close(&sd_file);
+#ifdef RAMDISK
+	if (drive == ram_drive) {
+		if (!ram_flush()) {
+			puts("Disk in RAM can't be written back\n");
+			return;
+		}
+		ram_drive = -1;
+	}
+#endif
 	strcpy(disks[drive], SFN);
+	dsk_map[drive].size = 0;
+#if BOOT_TRKS > 0
+	if (drive == 0)
+		boot_valid = false;
+#endif
 	putchar('\n');
 }
 
 /*
- * prepare I/O for sector read and write routines
+ * Get the geometry of the disk image in 'drive' from its size, images
+ * with an unknown size are handled as 8" SSSD floppy disks.
+ * Check if the disk image is stored in consecutive clusters
+ * on the MicroSD. If so, remember the first block of the image, so that
+ * sector I/O can access the card directly without going through FatFS.
+ */
+static void map_disk(int drive)
+{
+	DWORD clst, clsz, step;
+	FSIZE_t fsz;
+	register unsigned int i;
+
+	dsk_map[drive].lba = 0;
+	dsk_map[drive].geom = 0;
+
+	if (f_open(&sd_file, disks[drive], FA_READ) != FR_OK)
+		return;
+
+	fsz = dsk_map[drive].size = f_size(&sd_file);
+	for (i = 1; i < NUMGEOM; i++)
+		if (fsz == dsk_geom[i].size)
+			dsk_map[drive].geom = i;
+
+	clsz = (DWORD) fs.csize * FF_MAX_SS;
+	clst = sd_file.obj.sclust - 1;
+
+	/* follow the cluster chain, stop if not contiguous */
+	while (fsz) {
+		step = (fsz >= clsz) ? clsz : (DWORD) fsz;
+		if (f_lseek(&sd_file, f_tell(&sd_file) + step) != FR_OK)
+			break;
+		if (clst + 1 != sd_file.clust)
+			break;
+		clst = sd_file.clust;
+		fsz -= step;
+	}
+	if (fsz == 0 && dsk_map[drive].size > 0)
+		dsk_map[drive].lba = fs.database + (LBA_t) fs.csize *
+				     (sd_file.obj.sclust - 2);
+
+	f_close(&sd_file);
+}
+
+/*
+ * read or write a sector with 'len' bytes of a contiguous disk image
+ * @ pos directly from/to the MicroSD, data is transferred from/to dsk_buf
  */
-static BYTE prep_io(int drive, int track, int sector, WORD addr)
+static bool raw_io(int drive, FSIZE_t pos, unsigned int len, bool write)
 {
+	LBA_t lba = dsk_map[drive].lba + (LBA_t) (pos / FF_MAX_SS);
+	unsigned int off = (unsigned int) (pos % FF_MAX_SS);
+
+	if (pos + len > dsk_map[drive].size)
+		return false;
+
+#if LIB_STDIO_MSC_USB
+	/* bypasses FatFS and the disk function wrappers */
+	stdio_msc_usb_app_sd_access();
+#endif
+
+	/* get block with the sector into the cache, unless it is
+	   completely overwritten */
+	if (lba != blk_lba && !(write && len == FF_MAX_SS)) {
+		blk_lba = 0;
+		if (sd_card.read_blocks(&sd_card, blk_buf, lba, 1)
+		    != SD_BLOCK_DEVICE_ERROR_NONE)
+			return false;
+		blk_lba = lba;
+	}
+
+	if (write) {
+		memcpy(&blk_buf[off], dsk_buf, len);
+		blk_lba = lba;
+		if (sd_card.write_blocks(&sd_card, blk_buf, lba, 1)
+		    != SD_BLOCK_DEVICE_ERROR_NONE) {
+			blk_lba = 0;
+			return false;
+		}
+	} else
+		memcpy(dsk_buf, &blk_buf[off], len);
+
+	return true;
+}
+
+#ifdef RAMDISK
+/*
+ * write tracks modified in RAM back to the disk image on MicroSD,
+ * returns false if not all tracks were written, they are tried
+ * again ramdisk_flush seconds later
+ */
+static bool ram_flush(void)
+{
+	register int i;
 	FSIZE_t pos;
+	unsigned int n, bw;
+
+	if (ram_dirty_t == 0)
+		return true;
+
+	put_pixel(0x004400); /* LED red */
+
+	sd_res = f_open(&sd_file, ram_name, FA_WRITE);
+	if (sd_res == FR_OK) {
+		for (i = 0; i < TRK; i++) {
+			if (!ram_dirty[i])
+				continue;
+			pos = (FSIZE_t) i * RAM_TRKSZ;
+			n = (pos + RAM_TRKSZ > ram_size) ?
+				(unsigned int) (ram_size - pos) : RAM_TRKSZ;
+			if ((sd_res = f_lseek(&sd_file, pos)) != FR_OK ||
+			    (sd_res = f_write(&sd_file, &ram_dsk[pos], n, &bw))
+			    != FR_OK)
+				break;
+			if (bw != n) {		/* MicroSD full */
+				sd_res = FR_DENIED;
+				break;
+			}
+			ram_dirty[i] = false;
+		}
+		if (f_close(&sd_file) != FR_OK && sd_res == FR_OK)
+			sd_res = FR_DISK_ERR;
+	}
+
+	/* block cache might have an outdated copy */
+	blk_lba = 0;
+
+	put_pixel(0x000000); /* LED off */
+
+	if (sd_res != FR_OK) {
+		printf("RAM disk flush error: %s (%d)\n",
+		       FRESULT_str(sd_res), sd_res);
+		ram_dirty_t = get_clock_us();	/* try again later */
+		return false;
+	}
+	ram_dirty_t = 0;
+	return true;
+}
+
+/*
+ * make sure the disk image in 'drive' is loaded into RAM,
+ * returns false if it doesn't fit
+ */
+static bool ram_select(int drive)
+{
+	unsigned int br;
+
+	if (drive == ram_drive && strcmp(ram_name, disks[drive]) == 0)
+		return ram_size != 0;
+
+	/* the other image stays in RAM until it is written back */
+	if (!ram_flush())
+		return false;
+	ram_drive = drive;
+	strcpy(ram_name, disks[drive]);
+	ram_size = 0;
+
+	if (f_open(&sd_file, ram_name, FA_READ) != FR_OK)
+		return false;
+	if (f_size(&sd_file) <= sizeof(ram_dsk)) {
+		put_pixel(0x440000); /* LED green */
+		sd_res = f_read(&sd_file, ram_dsk, sizeof(ram_dsk), &br);
+		if (sd_res == FR_OK && br == f_size(&sd_file))
+			ram_size = br;
+		put_pixel(0x000000); /* LED off */
+	}
+	f_close(&sd_file);
+	memset(ram_dirty, 0, sizeof(ram_dirty));
+
+	return ram_size != 0;
+}
+#endif
+
+/*
+ * write the disk image in RAM back, if it was modified ramdisk_flush
+ * seconds ago, called with the disk I/O and from the console status
+ * port, so that it is also written if the guest stops disk I/O
+ */
+void disks_tick(void)
+{
+#ifdef RAMDISK
+	if (ram_dirty_t && ramdisk_flush > 0 && get_clock_us() -
+	    ram_dirty_t >= (uint64_t) ramdisk_flush * 1000000)
+		ram_flush();
+#endif
+}
+
+/*
+ * get the geometry of the disk image in 'drive',
+ * returns 0 if there is no disk in the drive, else the disk type:
+ * 1 = 8" SSSD floppy, 2 = 4 MB hard disk, 3 = 8 MB hard disk
+ */
+int disk_geom(int drive, int *trk, int *spt, int *secsz)
+{
+	int i;
+
+	*trk = *spt = *secsz = 0;
+
+	if ((drive < 0) || (drive > 3) || !strlen(disks[drive]))
+		return 0;
+	if (dsk_map[drive].size == 0)
+		map_disk(drive);
+	if (dsk_map[drive].size == 0)
+		return 0;
+
+	i = dsk_map[drive].geom;
+	*trk = dsk_geom[i].trk;
+	*spt = dsk_geom[i].spt;
+	*secsz = dsk_geom[i].secsz;
+	return i + 1;
+}
+
+/*
+ * prepare I/O for sector read and write routines,
+ * returns position of the sector in the disk image in pos,
+ * the sector size in len and how to transfer the sector in mode
+ */
+static BYTE prep_io(int drive, int track, int sector, WORD addr,
+		    FSIZE_t *pos, unsigned int *len, enum io_mode *mode)
+{
+	int trk, spt, secsz;
 
 	/* check if drive in range */
 	if ((drive < 0) || (drive > 3))
 		return FDC_STAT_DISK;
 
+	/* check if disk in drive and get its geometry */
+	if (disk_geom(drive, &trk, &spt, &secsz) == 0)
+		return FDC_STAT_NODISK;
+
 	/* check if track and sector in range */
-	if (track > TRK)
+	if (track >= trk)
 		return FDC_STAT_TRACK;
-	if ((sector < 1) || (sector > SPT))
+	if ((sector < 1) || (sector > spt))
 		return FDC_STAT_SEC;
 
 	/* check if DMA address in range */
-	if (addr > 0xff7f)
+	if (addr > 0xffff - secsz)
 		return FDC_STAT_DMAADR;
 
-	/* check if disk in drive */
-	if (!strlen(disks[drive])) {
-		return FDC_STAT_NODISK;
+	/* position of track/sector in the disk image */
+	*pos = (((FSIZE_t) track * (FSIZE_t) spt) + sector - 1) * secsz;
+	*len = secsz;
+
+#ifdef RAMDISK
+	/* check if the disk image is in RAM, an image not written back */
+	/* yet is kept there, even if another drive was configured */
+	if ((drive == ramdisk || drive == ram_drive) && ram_select(drive)) {
+		if (*pos + secsz > ram_size)
+			return FDC_STAT_SEEK;
+		disks_tick();
+		*mode = IO_RAM;
+		return FDC_STAT_OK;
+	}
+#endif
+
+	/* check if we can bypass FatFS */
+	if (dsk_map[drive].lba) {
+		*mode = IO_RAW;
+		return FDC_STAT_OK;
 	}
 
 	/* open file with the disk image */
@@ -255,45 +926,151 @@ static BYTE prep_io(int drive, int track, int sector, WORD addr)
 		return FDC_STAT_NODISK;
 
 	/* seek to track/sector */
-	pos = (((FSIZE_t) track * (FSIZE_t) SPT) + sector - 1) * SEC_SZ;
-	if (f_lseek(&sd_file, pos) != FR_OK) {
+	if (f_lseek(&sd_file, *pos) != FR_OK) {
 		f_close(&sd_file);
 		return FDC_STAT_SEEK;
 	}
+	*mode = IO_FATFS;
 	return FDC_STAT_OK;
 }
 
+#ifdef DISKTRACE
+/*
+ * write the recorded sector requests to the trace file on MicroSD
+ */
+static void trace_flush(void)
+{
+	unsigned int bw;
+
+	if (trace_n == 0)
+		return;
+
+	sd_res = f_open(&sd_file, DSKTRACE_FILE, FA_WRITE | (trace_new ?
+			FA_CREATE_ALWAYS : FA_OPEN_APPEND));
+	if (sd_res == FR_OK) {
+		if (trace_new)
+			sd_res = f_write(&sd_file, DSKTRACE_MAGIC,
+					 strlen(DSKTRACE_MAGIC), &bw);
+		if (sd_res == FR_OK)
+			sd_res = f_write(&sd_file, trace_buf, trace_n *
+					 sizeof(struct dsktrace_rec), &bw);
+		f_close(&sd_file);
+	}
+	if (sd_res != FR_OK)
+		printf("disk trace write error: %s (%d)\n",
+		       FRESULT_str(sd_res), sd_res);
+
+	trace_new = false;
+	trace_n = 0;
+}
+
+/*
+ * record a sector request started at time t,
+ * the trace file is written when the buffer is full
+ */
+static void trace_rec(uint64_t t, int drive, int track, int sector,
+		      int op, BYTE stat)
+{
+	struct dsktrace_rec *p = &trace_buf[trace_n];
+
+	if (trace_t0 == 0)
+		trace_t0 = t;
+
+	p->time = (uint32_t) (t - trace_t0);
+	p->latency = (uint32_t) (get_clock_us() - t);
+	p->drive = drive;
+	p->track = track;
+	p->sector = sector;
+	p->op = op;
+	p->stat = stat;
+
+	if (++trace_n == TRACE_N)
+		trace_flush();
+}
+#endif
+
+#if BOOT_TRKS > 0
+/*
+ * read the system tracks of drive 0 into boot_buf with one request,
+ * the FatFS file is open and positioned by prep_io() for mode IO_FATFS
+ */
+static void boot_load(enum io_mode mode)
+{
+	unsigned int br;
+
+	if (dsk_map[0].geom != 0 || dsk_map[0].size < BOOT_BLKS * FF_MAX_SS)
+		return;
+
+	if (mode == IO_RAW)
+		boot_valid = sd_card.read_blocks(&sd_card, boot_buf,
+						 dsk_map[0].lba, BOOT_BLKS)
+			     == SD_BLOCK_DEVICE_ERROR_NONE;
+	else
+		boot_valid = f_lseek(&sd_file, 0) == FR_OK &&
+			     f_read(&sd_file, boot_buf, BOOT_SZ, &br) == FR_OK &&
+			     br == BOOT_SZ;
+}
+#endif
+
 /*
  * read from drive a sector on track into memory @ addr
  */
-BYTE read_sec(int drive, int track, int sector, WORD addr)
+static BYTE do_read_sec(int drive, int track, int sector, WORD addr)
 {
 	BYTE stat;
-	unsigned int br;
-	register int i;
+	FSIZE_t pos;
+	enum io_mode mode;
+	unsigned int len, br;
+	register unsigned int i;
 
 	/* prepare for sector read */
-	if ((stat = prep_io(drive, track, sector, addr)) != FDC_STAT_OK)
+	if ((stat = prep_io(drive, track, sector, addr, &pos, &len, &mode))
+	    != FDC_STAT_OK)
 		return stat;
 
+#ifdef RAMDISK
+	/* no need to bother the LED, it wouldn't be visible anyway */
+	if (mode == IO_RAM) {
+		for (i = 0; i < len; i++)
+			dma_write(addr + i, ram_dsk[pos + i]);
+		return FDC_STAT_OK;
+	}
+#endif
+
+#if BOOT_TRKS > 0
+	if (drive == 0 && track < BOOT_TRKS) {
+		if (!boot_valid && track == 0 && sector == 1) {
+			put_pixel(0x440000); /* LED green */
+			boot_load(mode);
+			put_pixel(0x000000); /* LED off */
+		}
+		if (boot_valid) {
+			if (mode == IO_FATFS)
+				f_close(&sd_file);
+			for (i = 0; i < len; i++)
+				dma_write(addr + i, boot_buf[pos + i]);
+			return FDC_STAT_OK;
+		}
+	}
+#endif
+
 	put_pixel(0x440000); /* LED green */
 
 	/* read sector into memory */
-	sd_res = f_read(&sd_file, &dsk_buf[0], SEC_SZ, &br);
-	if (sd_res == FR_OK) {
-		if (br < SEC_SZ) {	/* UH OH */
-			f_close(&sd_file);
-			stat = FDC_STAT_READ;
-		} else {
-			f_close(&sd_file);
-			for (i = 0; i < SEC_SZ; i++)
-				dma_write(addr + i, dsk_buf[i]);
-			stat = FDC_STAT_OK;
-		}
+	if (mode == IO_RAW) {
+		stat = raw_io(drive, pos, len, false) ? FDC_STAT_OK
+						      : FDC_STAT_READ;
 	} else {
+		sd_res = f_read(&sd_file, &dsk_buf[0], len, &br);
+		if (sd_res == FR_OK && br == len)
+			stat = FDC_STAT_OK;
+		else			/* UH OH */
+			stat = FDC_STAT_READ;
 		f_close(&sd_file);
-		stat = FDC_STAT_READ;
 	}
+	if (stat == FDC_STAT_OK)
+		for (i = 0; i < len; i++)
+			dma_write(addr + i, dsk_buf[i]);
 
 	sleep_us(300);
 	put_pixel(0x000000); /* LED off */
@@ -303,33 +1080,52 @@ BYTE read_sec(int drive, int track, int sector, WORD addr)
 /*
  * write to drive a sector on track from memory @ addr
  */
-BYTE write_sec(int drive, int track, int sector, WORD addr)
+static BYTE do_write_sec(int drive, int track, int sector, WORD addr)
 {
 	BYTE stat;
-	unsigned int br;
-	register int i;
+	FSIZE_t pos;
+	enum io_mode mode;
+	unsigned int len, br;
+	register unsigned int i;
 
 	/* prepare for sector write */
-	if ((stat = prep_io(drive, track, sector, addr)) != FDC_STAT_OK)
+	if ((stat = prep_io(drive, track, sector, addr, &pos, &len, &mode))
+	    != FDC_STAT_OK)
 		return stat;
 
+#ifdef RAMDISK
+	/* write into RAM and remember the track for write back */
+	if (mode == IO_RAM) {
+		for (i = 0; i < len; i++)
+			ram_dsk[pos + i] = dma_read(addr + i);
+		ram_dirty[pos / RAM_TRKSZ] = true;
+		if (ram_dirty_t == 0)
+			ram_dirty_t = get_clock_us();
+		return FDC_STAT_OK;
+	}
+#endif
+
+#if BOOT_TRKS > 0
+	/* written system tracks are read again at the next boot */
+	if (drive == 0 && track < BOOT_TRKS)
+		boot_valid = false;
+#endif
+
 	put_pixel(0x004400); /* LED red */
 
 	/* write sector to disk image */
-	for (i = 0; i < SEC_SZ; i++)
+	for (i = 0; i < len; i++)
 		dsk_buf[i] = dma_read(addr + i);
-	sd_res = f_write(&sd_file, &dsk_buf[0], SEC_SZ, &br);
-	if (sd_res == FR_OK) {
-		if (br < SEC_SZ) {	/* UH OH */
-			f_close(&sd_file);
-			stat = FDC_STAT_WRITE;
-		} else {
-			f_close(&sd_file);
-			stat = FDC_STAT_OK;
-		}
+	if (mode == IO_RAW) {
+		stat = raw_io(drive, pos, len, true) ? FDC_STAT_OK
+						     : FDC_STAT_WRITE;
 	} else {
+		sd_res = f_write(&sd_file, &dsk_buf[0], len, &br);
+		if (sd_res == FR_OK && br == len)
+			stat = FDC_STAT_OK;
+		else			/* UH OH */
+			stat = FDC_STAT_WRITE;
 		f_close(&sd_file);
-		stat = FDC_STAT_WRITE;
 	}
 
 	sleep_us(300);
@@ -337,6 +1133,35 @@ BYTE write_sec(int drive, int track, int sector, WORD addr)
 	return stat;
 }
 
+/*
+ * sector read and write functions called by the FDC
+ */
+BYTE read_sec(int drive, int track, int sector, WORD addr)
+{
+#ifdef DISKTRACE
+	uint64_t t = get_clock_us();
+	BYTE stat = do_read_sec(drive, track, sector, addr);
+
+	trace_rec(t, drive, track, sector, DSKTRACE_READ, stat);
+	return stat;
+#else
+	return do_read_sec(drive, track, sector, addr);
+#endif
+}
+
+BYTE write_sec(int drive, int track, int sector, WORD addr)
+{
+#ifdef DISKTRACE
+	uint64_t t = get_clock_us();
+	BYTE stat = do_write_sec(drive, track, sector, addr);
+
+	trace_rec(t, drive, track, sector, DSKTRACE_WRITE, stat);
+	return stat;
+#else
+	return do_write_sec(drive, track, sector, addr);
+#endif
+}
+
 /*
  * get FDC command from CPU memory
  */
@@ -344,6 +1169,8 @@ void get_fdccmd(BYTE *cmd, WORD addr)
 {
 	register int i;
 
+	/* the BIOS sets the address once, remember it for snapshots */
+	fdc_cmd_addr = addr;
 	for (i = 0; i < 4; i++)
 		cmd[i] = dma_read(addr + i);
 }
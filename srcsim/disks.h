@@ -8,6 +8,9 @@
  *
  * History:
  * 29-JUN-2024 split of from memsim.c and picosim.c
+ * 19-OCT-2026 keep a disk image in RAM on RP2350
+ * 19-OCT-2026 per drive geometry, support 4 MB and 8 MB hard disk images
+ * 19-OCT-2026 cache for the system tracks of drive 0
  */
 
 #ifndef DISKS_INC
@@ -20,16 +23,29 @@
 #define FNLEN	8		/* length of filename without extension */
 #define DISKLEN	9 + FNLEN + 4	/* path length for disk drives /DISKS80/filename.DSK */
 				/* also used for code files /CODE80/filename.BIN */
+#define HDSEC_SZ 512		/* sector size of hard disk images */
+#if PICO_RP2350
+#define RAMDISK			/* enough memory to keep a disk image in RAM */
+#endif
+#define BOOT_TRKS 2		/* system tracks of drive 0 read at once at boot */
+				/* and kept in RAM, 0 = no cache */
+/*#define DISKTRACE*/		/* record sector requests in /CONF80/DSKTRACE.DAT */
 
 extern FIL sd_file;
 extern FRESULT sd_res;
 extern char disks[NUMDISK][DISKLEN+1];
+extern int ramdisk, ramdisk_flush;
+extern int fdc_cmd_addr;
 
 extern void init_disks(void), exit_disks(void);
+extern void disks_tick(void);
 extern void list_files(const char *dir, const char *ext);
-extern bool load_file(const char *name);
+extern int find_files(const char *dir, const char *ext, const char *prefix,
+		      char *name);
+extern bool load_file(const char *name, int addr, WORD *start);
 extern void check_disks(void);
 extern void mount_disk(int drive, const char *name);
+extern int disk_geom(int drive, int *trk, int *spt, int *secsz);
 
 extern BYTE read_sec(int drive, int track, int sector, WORD addr);
 extern BYTE write_sec(int drive, int track, int sector, WORD addr);
@@ -0,0 +1,37 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Record format of the disk access trace, written by disks.c
+ * if DISKTRACE is defined, and read by the replay tool srchost/dskreplay.c.
+ * The file starts with DSKTRACE_MAGIC followed by the records,
+ * all values are little endian.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef DSKTRACE_INC
+#define DSKTRACE_INC
+
+#include <stdint.h>
+
+#define DSKTRACE_MAGIC	"DTR1"		/* 4 bytes at start of trace file */
+#define DSKTRACE_FILE	"/CONF80/DSKTRACE.DAT"
+
+#define DSKTRACE_READ	0		/* values for op */
+#define DSKTRACE_WRITE	1
+
+struct dsktrace_rec {
+	uint32_t time;		/* start of request in us since first request */
+	uint32_t latency;	/* duration of request in us */
+	uint8_t drive;		/* drive 0-3 */
+	uint8_t track;		/* track */
+	uint8_t sector;		/* sector, starting with 1 */
+	uint8_t op;		/* DSKTRACE_READ or DSKTRACE_WRITE */
+	uint8_t stat;		/* FDC status returned */
+	uint8_t pad[3];
+};
+
+#endif /* !DSKTRACE_INC */
@@ -12,6 +12,8 @@
 #include "simdefs.h"
 #include "simglb.h"
 #include "dazzler.h"
+#include "vdm.h"
+#include "cpusnap.h"
 
 #include "lcd.h"
 #include "LCD_GUI.h"
@@ -132,14 +134,35 @@ static void __not_in_flash_func(lcd_show_time)(void)
 		    BLACK, BLUE);
 }
 
+#define LCD_REFRESH 5 /* in ticks/frames per second */
+#define LCD_REFRESH_US (1000000 / LCD_REFRESH)
+#define VDM_REFRESH_US (1000000 / 25) /* only changed rows are drawn */
+
 static const char *__not_in_flash("hex_table") hex = "0123456789ABCDEF";
 static inline char hex3(uint16_t x) { return hex[(x >> 12) & 0xf]; }
 static inline char hex2(uint16_t x) { return hex[(x >> 8) & 0xf]; }
 static inline char hex1(uint16_t x) { return hex[(x >> 4) & 0xf]; }
 static inline char hex0(uint16_t x) { return hex[x & 0xf]; }
 
+/*
+ * The registers are taken from the snapshot published by the CPU.
+ * If the CPU didn't publish one for a second, because it runs code
+ * without I/O or is stopped, the registers are read directly.
+ */
 static void __not_in_flash_func(lcd_show_cpu)(void)
 {
+	static uint32_t last_seq;
+	static int stale;
+	struct cpu_snap s;
+
+	if (cpu_snap_seq != last_seq) {
+		last_seq = cpu_snap_seq;
+		stale = 0;
+	} else if (stale <= LCD_REFRESH)
+		stale++;
+	if (stale > LCD_REFRESH || !cpu_snap_get(&s))
+		cpu_snap_live(&s);
+
 	if (first_flag) {
 		GUI_DrawRectangle(10, 60, 140, 155, GRAY, DRAW_FULL,
 				  DOT_PIXEL_1X1);
@@ -154,51 +177,55 @@ static void __not_in_flash_func(lcd_show_cpu)(void)
 		first_flag = false;
 	}
 
-	GUI_DisChar(60, 65, hex3(PC), &Font24, BROWN, BLUE);
-	GUI_DisChar(77, 65, hex2(PC), &Font24, BROWN, BLUE);
-	GUI_DisChar(94, 65, hex1(PC), &Font24, BROWN, BLUE);
-	GUI_DisChar(111, 65, hex0(PC), &Font24, BROWN, BLUE);
-
-	GUI_DisChar(60, 95, hex3(SP), &Font24, BROWN, BLUE);
-	GUI_DisChar(77, 95, hex2(SP), &Font24, BROWN, BLUE);
-	GUI_DisChar(94, 95, hex1(SP), &Font24, BROWN, BLUE);
-	GUI_DisChar(111, 95, hex0(SP), &Font24, BROWN, BLUE);
-
-	GUI_DisChar(60, 125, hex1(A), &Font24, BROWN, BLUE);
-	GUI_DisChar(77, 125, hex0(A), &Font24, BROWN, BLUE);
-	GUI_DisChar(94, 125, hex1(F), &Font24, BROWN, BLUE);
-	GUI_DisChar(111, 125, hex0(F), &Font24, BROWN, BLUE);
-
-	GUI_DisChar(195, 65, hex1(B), &Font24, BROWN, BLUE);
-	GUI_DisChar(212, 65, hex0(B), &Font24, BROWN, BLUE);
-	GUI_DisChar(229, 65, hex1(C), &Font24, BROWN, BLUE);
-	GUI_DisChar(246, 65, hex0(C), &Font24, BROWN, BLUE);
-
-	GUI_DisChar(195, 95, hex1(D), &Font24, BROWN, BLUE);
-	GUI_DisChar(212, 95, hex0(D), &Font24, BROWN, BLUE);
-	GUI_DisChar(229, 95, hex1(E), &Font24, BROWN, BLUE);
-	GUI_DisChar(246, 95, hex0(E), &Font24, BROWN, BLUE);
-
-	GUI_DisChar(195, 125, hex1(H), &Font24, BROWN, BLUE);
-	GUI_DisChar(212, 125, hex0(H), &Font24, BROWN, BLUE);
-	GUI_DisChar(229, 125, hex1(L), &Font24, BROWN, BLUE);
-	GUI_DisChar(246, 125, hex0(L), &Font24, BROWN, BLUE);
+	GUI_DisChar(60, 65, hex3(s.pc), &Font24, BROWN, BLUE);
+	GUI_DisChar(77, 65, hex2(s.pc), &Font24, BROWN, BLUE);
+	GUI_DisChar(94, 65, hex1(s.pc), &Font24, BROWN, BLUE);
+	GUI_DisChar(111, 65, hex0(s.pc), &Font24, BROWN, BLUE);
+
+	GUI_DisChar(60, 95, hex3(s.sp), &Font24, BROWN, BLUE);
+	GUI_DisChar(77, 95, hex2(s.sp), &Font24, BROWN, BLUE);
+	GUI_DisChar(94, 95, hex1(s.sp), &Font24, BROWN, BLUE);
+	GUI_DisChar(111, 95, hex0(s.sp), &Font24, BROWN, BLUE);
+
+	GUI_DisChar(60, 125, hex1(s.a), &Font24, BROWN, BLUE);
+	GUI_DisChar(77, 125, hex0(s.a), &Font24, BROWN, BLUE);
+	GUI_DisChar(94, 125, hex1(s.f), &Font24, BROWN, BLUE);
+	GUI_DisChar(111, 125, hex0(s.f), &Font24, BROWN, BLUE);
+
+	GUI_DisChar(195, 65, hex1(s.b), &Font24, BROWN, BLUE);
+	GUI_DisChar(212, 65, hex0(s.b), &Font24, BROWN, BLUE);
+	GUI_DisChar(229, 65, hex1(s.c), &Font24, BROWN, BLUE);
+	GUI_DisChar(246, 65, hex0(s.c), &Font24, BROWN, BLUE);
+
+	GUI_DisChar(195, 95, hex1(s.d), &Font24, BROWN, BLUE);
+	GUI_DisChar(212, 95, hex0(s.d), &Font24, BROWN, BLUE);
+	GUI_DisChar(229, 95, hex1(s.e), &Font24, BROWN, BLUE);
+	GUI_DisChar(246, 95, hex0(s.e), &Font24, BROWN, BLUE);
+
+	GUI_DisChar(195, 125, hex1(s.h), &Font24, BROWN, BLUE);
+	GUI_DisChar(212, 125, hex0(s.h), &Font24, BROWN, BLUE);
+	GUI_DisChar(229, 125, hex1(s.l), &Font24, BROWN, BLUE);
+	GUI_DisChar(246, 125, hex0(s.l), &Font24, BROWN, BLUE);
 }
 
-#define LCD_REFRESH 5 /* in ticks/frames per second */
-#define LCD_REFRESH_US (1000000 / LCD_REFRESH)
 
 void __not_in_flash_func(lcd_task)(void)
 {
 	absolute_time_t t;
-	int64_t d;
+	int64_t d, period;
 	int ticks = 0;
 
-	/* loops every LCD_REFRESH_US */
+	/* loops every LCD_REFRESH_US, or VDM_REFRESH_US for the VDM-1 */
 	while (do_refresh) {
 		t = get_absolute_time();
+		period = LCD_REFRESH_US;
 
-		if (!dazzler_state) {
+		if (dazzler_state) {
+			dazzler_draw();
+		} else if (vdm_state) {
+			vdm_draw();
+			period = VDM_REFRESH_US;
+		} else {
 			/* update time/temperature once a second */
 			if (first_flag) {
 				GUI_Clear(BLACK);
@@ -209,13 +236,11 @@ void __not_in_flash_func(lcd_task)(void)
 
 			/* update VM CPU registers on each run */
 			lcd_show_cpu();
-		} else {
-			dazzler_draw();
 		}
 
 		d = absolute_time_diff_us(t, get_absolute_time());
-		if (d < LCD_REFRESH_US)
-			sleep_us(LCD_REFRESH_US - d);
+		if (d < period)
+			sleep_us(period - d);
 		//else
 		//	puts("REFRESH!");
 
@@ -14,10 +14,19 @@
  * 31-MAY-2024 use USB UART
  * 09-JUN-2024 implemented boot ROM
  * 11-JUN-2024 ported to Pico Eval Board
+ * 19-OCT-2026 added ICE command to run the speed benchmark
+ * 19-OCT-2026 save snapshot of the machine when stopped with User Key
+ * 19-OCT-2026 fill memory after reading the configuration, report startup time
+ * 19-OCT-2026 load address for ICE r command
+ * 19-OCT-2026 headless batch mode
+ * 19-OCT-2026 restart without waiting for a key after the batch script
+ * 19-OCT-2026 report USB console throughput
+ * 19-OCT-2026 stop read-only USB mass storage after the run
  */
 
 /* Raspberry SDK and FatFS includes */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #if LIB_PICO_STDIO_USB || LIB_STDIO_MSC_USB
@@ -51,8 +60,12 @@
 #include "simio.h"
 #ifdef WANT_ICE
 #include "simice.h"
+#include "simbench.h"
 #endif
 #include "disks.h"
+#include "snapshot.h"
+#include "simbatch.h"
+#include "sysclk.h"
 #include "lcd.h"
 #include "rgbled.h"
 
@@ -106,6 +119,8 @@ int main(void)
 {
 	char s[2];
 	uint32_t rgb = 0x005500;
+	uint64_t t0, t1, t_wait = 0;
+	bool batch;
 
 	stdio_init_all();	/* initialize stdio */
 #if LIB_STDIO_MSC_USB
@@ -136,7 +151,7 @@ int main(void)
 	/* initialize RGB LED */
 	sm = pio_claim_unused_sm(pio, true);
 	uint offset = pio_add_program(pio, &ws2812_program);
-	ws2812_program_init(pio, sm, offset, WS2812_PIN, 800000, true);
+	ws2812_program_init(pio, sm, offset, WS2812_PIN, WS2812_FREQ, true);
 	put_pixel(rgb); /* red */
 
 #if LIB_PICO_STDIO_UART
@@ -149,6 +164,7 @@ int main(void)
 	/* when using USB UART wait until it is connected */
 	/* but also get out if there is input at default UART */
 #if LIB_PICO_STDIO_USB || LIB_STDIO_MSC_USB
+	t0 = get_clock_us();
 	lcd_wait_term();
 	while (!tud_cdc_connected()) {
 #if LIB_PICO_STDIO_UART
@@ -163,6 +179,7 @@ int main(void)
 		put_pixel(rgb);
 		sleep_ms(50);
 }
+	t_wait = get_clock_us() - t0;	/* not part of the startup time */
 #endif
 	put_pixel(0x000044); /* blue */
 
@@ -170,7 +187,6 @@ int main(void)
 	lcd_banner();
 	printf("\fZ80pack release %s, %s\n", RELEASE, COPYR);
 	printf("%s release %s\n", USR_COM, USR_REL);
-	printf("running on ARM Cortex-M0+ cores at %i MHz\n", SYS_CLK_MHZ);
 	printf("%s\n\n", USR_CPR);
 
 #ifdef WANT_ICE
@@ -182,10 +198,19 @@ int main(void)
 	init_cpu();		/* initialize CPU */
 	PC = 0xff00;		/* power on jump into the boot ROM */
 	init_disks();		/* initialize disk drives */
-	init_memory();		/* initialize memory configuration */
 	init_io();		/* initialize I/O devices */
 
 	read_config();          /* read configuration from MicroSD */
+	/* the clock might have been changed by the configuration */
+	printf("running on ARM Cortex-M0+ cores at %i MHz\n", sysclk_mhz());
+
+	t0 = get_clock_us();
+	init_memory();		/* initialize memory configuration */
+	t1 = get_clock_us();
+	printf("machine initialized %" PRIu64 " ms after reset, "
+	       "memory in %" PRIu64 " us, %" PRIu64 " ms waiting for the "
+	       "terminal\n\n", (t1 - t_wait) / 1000, t1 - t0,
+	       t_wait / 1000);
 
 #ifdef RASPBERRYPI_PICO_W	/* initialize Pico W hardware */
 	/* initialize Pico W WiFi hardware */
@@ -220,8 +245,10 @@ int main(void)
 wifi_done:
 #endif
 
+	batch_load();		/* batch script overrides the configuration */
 	config();		/* configure the machine */
-	save_config();          /* save configuration on MicroSD */
+	if (!batch_active)
+		save_config();	/* save configuration on MicroSD */
 
 	f_value = speed;	/* setup speed of the CPU */
 	if (f_value)
@@ -234,15 +261,23 @@ wifi_done:
 	multicore_launch_core1(lcd_task); /* start LCD task on core 1 */
 
 	/* run the CPU with whatever is in memory */
+	batch = batch_active;
+	if (batch)
+		batch_run();
+	else {
 #ifdef WANT_ICE
-	ice_cust_cmd = picosim_ice_cmd;
-	ice_cust_help = picosim_ice_help;
-	ice_cmd_loop(0);
+		ice_cust_cmd = picosim_ice_cmd;
+		ice_cust_help = picosim_ice_help;
+		ice_cmd_loop(0);
 #else
-	run_cpu();
+		run_cpu();
 #endif
+	}
 
 	put_pixel(0x000000);	/* LED off */
+#if LIB_STDIO_MSC_USB
+	stdio_msc_usb_stop_concurrent_msc(); /* USB host can't read anymore */
+#endif
 	exit_disks();		/* stop disk drives */
 
 #if defined(RASPBERRYPI_PICO_W) || defined(RASPBERRYPI_PICO2_W)
@@ -255,9 +290,32 @@ wifi_done:
 	putchar('\n');
 	report_cpu_error();	/* check for CPU emulation errors and report */
 	report_cpu_stats();	/* print some execution statistics */
+#if LIB_STDIO_MSC_USB && !STDIO_MSC_USB_DISABLE_STDIO
+	stdio_msc_usb_stats_t usb_stats;
+
+	stdio_msc_usb_get_stats(&usb_stats);
+	printf("USB console: %" PRIu64 " bytes output, %lu bytes/s, "
+	       "peak %lu bytes/s\n", usb_stats.tx_bytes,
+	       (unsigned long) usb_stats.tx_rate,
+	       (unsigned long) usb_stats.tx_peak);
+#endif
 #endif
-	puts("\nPress any key to restart CPU");
-	get_cmdline(s, 2);
+	/* in batch mode nobody is at the terminal, restart right away */
+	if (!batch) {
+		if (cpu_error == USERINT) {
+			puts("\nPress s to save a snapshot, "
+			     "any other key to restart CPU");
+			get_cmdline(s, 2);
+			if (tolower((unsigned char) s[0]) == 's') {
+				init_disks();
+				save_snapshot();
+				exit_disks();
+			}
+		} else {
+			puts("\nPress any key to restart CPU");
+			get_cmdline(s, 2);
+		}
+	}
 
 	lcd_exit();		/* LCD off */
 	multicore_reset_core1();/* stop core 1 */
@@ -326,6 +384,8 @@ static void picosim_ice_cmd(char *cmd, WORD *wrk_addr)
 	WORD save_PC;
 	Tstates_t T0;
 	unsigned freq;
+	int addr;
+	WORD start;
 #ifdef WANT_HB
 	bool save_hb_flag;
 #endif
@@ -392,8 +452,16 @@ static void picosim_ice_cmd(char *cmd, WORD *wrk_addr)
 			cmd++;
 		for (s = cmd; *s; s++)
 			*s = toupper((unsigned char) *s);
-		if (load_file(cmd))
-			*wrk_addr = PC = 0;
+		/* optional load address after the file name */
+		addr = -1;
+		for (s = cmd; *s && !isspace((unsigned char) *s); s++)
+			;
+		if (*s) {
+			*s++ = '\0';
+			addr = (int) strtol(s, NULL, 16) & 0xffff;
+		}
+		if (load_file(cmd, addr, &start))
+			*wrk_addr = PC = start;
 		break;
 
 	case '!':
@@ -401,8 +469,14 @@ static void picosim_ice_cmd(char *cmd, WORD *wrk_addr)
 		while (isspace((unsigned char) *cmd))
 			cmd++;
 		if (strcasecmp(cmd, "ls") == 0)
-			list_files("/CODE80", "*.BIN");
-		else
+			list_files("/CODE80", "*.*");
+		else if (strncasecmp(cmd, "bench", 5) == 0) {
+			cmd += 5;
+			while (isspace((unsigned char) *cmd))
+				cmd++;
+			bench_run(cmd);
+			*wrk_addr = PC;
+		} else
 			puts("what??");
 		break;
 
@@ -415,8 +489,10 @@ static void picosim_ice_cmd(char *cmd, WORD *wrk_addr)
 static void picosim_ice_help(void)
 {
 	puts("c                         measure clock frequency");
-	puts("r filename                read file (without .BIN) into memory");
+	puts("r filename [address]      read file (without .BIN/.COM/.HEX)");
+	puts("                          into memory");
 	puts("! ls                      list files");
+	puts("! bench [filename]        run speed benchmark with examples");
 }
 
 #endif
@@ -4,6 +4,8 @@
 #include "hardware/pio.h"
 #include "WS2812.pio.h"
 
+#define WS2812_FREQ 800000	/* bit rate of the RGB LED */
+
 extern uint sm;
 extern PIO pio;
 
@@ -0,0 +1,290 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Headless batch mode. If the script BATCHFILE exists at power on,
+ * the configuration dialog is skipped and the machine is set up and
+ * run by the script, without a human at the terminal. One command
+ * per line, empty lines and lines starting with # are ignored:
+ *
+ *	cpu z80|8080		select CPU
+ *	speed n			CPU speed in MHz, 0 = unlimited
+ *	port xx			port 255 value in hex
+ *	disk n name|-		mount disk image name on drive n, - unmounts
+ *	load name [addr]	load file from CODE80, addr in hex
+ *	log name		write console output to file name in CONF80
+ *	timeout n		stop the run after n seconds
+ *	wait text		wait until text is output
+ *	send text		send keystrokes text
+ *
+ * The wait and send steps are executed in order by the SIO script
+ * engine in simscript.c while the machine runs. In text \r, \n, \t,
+ * \e, \\ and \xhh are the usual escapes. The run ends when the machine
+ * halts, when no keystrokes are pending and the program polls the SIO
+ * status in a tight loop waiting for input, after the timeout, or with
+ * the User Key. At the end a line with key=value pairs and the wall
+ * time is printed and written into the log, the script is renamed to
+ * BATCHOLD so that the next power on runs the configuration dialog
+ * again, and the machine is reset.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ * 19-OCT-2026 steps executed by the SIO script engine
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include "f_util.h"
+#include "ff.h"
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simcore.h"
+#include "simio.h"
+
+#include "disks.h"
+#include "picosim.h"
+#include "simscript.h"
+#include "simbatch.h"
+
+#define BATCH_LINELEN	128	/* max. length of a script line */
+#define BATCH_TEXTLEN	2048	/* space for wait and send steps */
+#define BATCH_TIMEOUT	3600	/* default timeout in s */
+
+bool batch_active;		/* machine is run by the script */
+
+static char steps[BATCH_TEXTLEN]; /* wait and send steps of the script */
+static unsigned int timeout = BATCH_TIMEOUT;
+
+static FIL log_file;
+static bool log_open;
+static BYTE log_buf[512];
+static UINT log_n;
+
+static void log_flush(void)
+{
+	UINT bw;
+
+	if (log_open && log_n > 0)
+		f_write(&log_file, log_buf, log_n, &bw);
+	log_n = 0;
+}
+
+static void log_put(BYTE c)
+{
+	if (!log_open)
+		return;
+	log_buf[log_n++] = c;
+	if (log_n == sizeof(log_buf))
+		log_flush();
+}
+
+/*
+ * output of the machine, shown on the terminal and written into the log
+ */
+static void batch_echo(BYTE data)
+{
+	putchar_raw((int) data);
+	log_put(data);
+}
+
+/*
+ * convert the escapes in s, returns false if the result
+ * contains a NUL character or is empty
+ */
+static bool unescape(char *s)
+{
+	char *d = s, *start = s, *end;
+	int c;
+
+	while ((c = *s++) != '\0') {
+		if (c == '\\') {
+			switch (c = *s++) {
+			case 'r': c = '\r'; break;
+			case 'n': c = '\n'; break;
+			case 't': c = '\t'; break;
+			case 'e': c = 0x1b; break;
+			case '\\': break;
+			case 'x':
+				c = (int) strtol(s, &end, 16);
+				if (end == s || end > s + 2)
+					return false;
+				s = end;
+				break;
+			default:
+				return false;
+			}
+			if (c == '\0')
+				return false;
+		}
+		*d++ = c;
+	}
+	*d = '\0';
+	return d != start;
+}
+
+/*
+ * add a wait or send step
+ */
+static bool add_step(char type, char *text, size_t *pos)
+{
+	if (!unescape(text))
+		return false;
+	return script_add(steps, sizeof(steps), pos, type, text);
+}
+
+/*
+ * execute one setup command or add a step
+ */
+static bool batch_cmd(char *cmd, char *arg, size_t *pos)
+{
+	char name[DISKLEN+1], *p, *end;
+	WORD start;
+	long n;
+
+	if (strcasecmp(cmd, "cpu") == 0) {
+		n = (strcasecmp(arg, "z80") == 0) ? Z80 :
+		    (strcasecmp(arg, "8080") == 0) ? I8080 : -1;
+		if (n < 0)
+			return false;
+#if !defined(EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
+		if (cpu != n)
+			switch_cpu(n);
+#else
+		if (cpu != n)
+			puts("batch: CPU not available");
+#endif
+	} else if (strcasecmp(cmd, "speed") == 0) {
+		n = strtol(arg, &end, 10);
+		if (*arg == '\0' || *end != '\0' || n < 0 || n > 40)
+			return false;
+		speed = n;
+	} else if (strcasecmp(cmd, "port") == 0) {
+		n = strtol(arg, &end, 16);
+		if (*arg == '\0' || *end != '\0' || n < 0 || n > 0xff)
+			return false;
+		fp_value = n;
+	} else if (strcasecmp(cmd, "disk") == 0) {
+		n = strtol(arg, &end, 10);
+		if (end == arg || n < 0 || n >= NUMDISK || *end != ' ')
+			return false;
+		while (*end == ' ')
+			end++;
+		if (strcmp(end, "-") == 0)
+			disks[n][0] = '\0';
+		else {
+			strncpy(name, end, 8);
+			name[8] = '\0';
+			for (p = name; *p; p++)
+				*p = toupper((unsigned char) *p);
+			mount_disk(n, name);
+		}
+	} else if (strcasecmp(cmd, "load") == 0) {
+		n = -1;
+		if ((p = strchr(arg, ' ')) != NULL) {
+			*p++ = '\0';
+			n = strtol(p, &end, 16);
+			if (*end != '\0' || n < 0 || n > 0xffff)
+				return false;
+		}
+		for (p = arg; *p; p++)
+			*p = toupper((unsigned char) *p);
+		if (!load_file(arg, n, &start))
+			return false;
+		if (start != 0)
+			PC = start;
+	} else if (strcasecmp(cmd, "log") == 0) {
+		if (log_open || strlen(arg) > 12 || strchr(arg, '/') != NULL)
+			return false;
+		strcpy(name, "/CONF80/");
+		strcat(name, arg);
+		sd_res = f_open(&log_file, name, FA_WRITE | FA_CREATE_ALWAYS);
+		if (sd_res != FR_OK) {
+			printf("batch: can't create %s: %s (%d)\n", name,
+			       FRESULT_str(sd_res), sd_res);
+			return false;
+		}
+		log_open = true;
+	} else if (strcasecmp(cmd, "timeout") == 0) {
+		n = strtol(arg, &end, 10);
+		if (*arg == '\0' || *end != '\0' || n <= 0 || n > 86400)
+			return false;
+		timeout = n;
+	} else if (strcasecmp(cmd, "wait") == 0)
+		return add_step(SCRIPT_WAIT, arg, pos);
+	else if (strcasecmp(cmd, "send") == 0)
+		return add_step(SCRIPT_SEND, arg, pos);
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * read and execute the setup commands of the batch script,
+ * if there is one the machine runs in batch mode
+ */
+void batch_load(void)
+{
+	FIL fp;
+	char line[BATCH_LINELEN], *arg, *p;
+	size_t pos = 0;
+	int n = 0;
+
+	if (f_open(&fp, BATCHFILE, FA_READ) != FR_OK)
+		return;
+
+	printf("running batch script %s\n", BATCHFILE);
+	while (f_gets(line, sizeof(line), &fp) != NULL) {
+		n++;
+		if ((p = strpbrk(line, "\r\n")) != NULL)
+			*p = '\0';
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+		if ((arg = strchr(line, ' ')) != NULL)
+			*arg++ = '\0';
+		else
+			arg = "";
+		if (!batch_cmd(line, arg, &pos))
+			printf("batch: error in line %d, ignored\n", n);
+	}
+	f_close(&fp);
+
+	batch_active = true;
+}
+
+/*
+ * run the machine with the steps of the batch script
+ */
+void batch_run(void)
+{
+	struct script_result r;
+	char s[160], *p;
+
+	script_run(steps, timeout * 1000, batch_echo, &r);
+	batch_active = false;
+
+	snprintf(s, sizeof(s), "\nbatch end=%s done=%d tstates=%"
+		 PRIu64 " time_us=%" PRIu64 " mhz=%u.%02u out=%lu\n",
+		 script_end_names[r.end], r.done, (uint64_t) r.tstates,
+		 r.us, r.mhz / 100, r.mhz % 100, r.out);
+	fputs(s, stdout);
+
+	if (log_open) {
+		for (p = s; *p; p++)
+			log_put(*p);
+		log_flush();
+		f_close(&log_file);
+		log_open = false;
+	}
+	f_unlink(BATCHOLD);
+	f_rename(BATCHFILE, BATCHOLD);
+}
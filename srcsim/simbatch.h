@@ -0,0 +1,27 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Headless batch mode, the machine is set up and run by a script
+ * on MicroSD instead of the configuration dialog.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SIMBATCH_INC
+#define SIMBATCH_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define BATCHFILE "/CONF80/BATCH.TXT"
+#define BATCHOLD  "/CONF80/BATCH.OLD"
+
+extern bool batch_active;
+
+extern void batch_load(void);
+extern void batch_run(void);
+
+#endif /* !SIMBATCH_INC */
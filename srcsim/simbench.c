@@ -0,0 +1,204 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Emulation speed benchmark with the example programs from CODE80.
+ * Each program is loaded with load_file() and run without speed limit
+ * by the SIO script engine, with the script from the table below. The
+ * run ends when the program halts, when it waits for input, after
+ * BENCH_TIMEOUT or with the User Key, see simscript.c. The output of
+ * the program is not shown, ok=1 means all steps of the script were
+ * done, so the expected text was output. For every program one line
+ * with key=value
+ * pairs is printed, so that results from RP2040, RP2350 ARM/RISC-V
+ * and host builds can be compared by scripts. The hit rate of the
+ * XIP flash cache during the run shows, how much the emulation is
+ * slowed down by code and tables fetched from flash, compare builds
+ * with and without PICOSIM_CORE_IN_RAM.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ * 19-OCT-2026 XIP cache hit rate
+ * 19-OCT-2026 programs are run by the SIO script engine
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#if !PICOSIM_HOST
+#include "hardware/structs/xip_ctrl.h"
+#endif
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simcore.h"
+#include "simio.h"
+#ifdef WANT_ICE
+#include "simice.h"
+#endif
+#include "ff.h"
+#include "disks.h"
+#include "simscript.h"
+#include "simbench.h"
+#include "sysclk.h"
+
+#define BENCH_TIMEOUT	60000	/* max. run time of a program in ms */
+
+#if PICOSIM_HOST
+#define BENCH_PLATFORM	"host"
+#elif PICO_RP2350 && defined(__riscv)
+#define BENCH_PLATFORM	"rp2350-riscv"
+#elif PICO_RP2350
+#define BENCH_PLATFORM	"rp2350-arm"
+#else
+#define BENCH_PLATFORM	"rp2040"
+#endif
+
+#if PICOSIM_CORE_IN_RAM
+#define BENCH_CORE	"ram"
+#else
+#define BENCH_CORE	"flash"
+#endif
+
+static const struct bench {
+	const char *name;	/* file in CODE80 without .BIN */
+	int cpu;		/* CPU to run it on */
+	BYTE fp;		/* port 255 value */
+	const char *script;	/* keystrokes and expected output */
+} benchs[] = {
+	{ "TEST8080", I8080, 0x00, SCRIPT_W("CPU IS OPERATIONAL") },
+	{ "TB", I8080, 0x00,
+	  SCRIPT_S("10 A=0\r20 FOR I=1 TO 10000\r30 A=A+1\r40 NEXT I\r"
+		   "50 PRINT A\rRUN\r")
+	  SCRIPT_W("10000") },
+	{ "MICRO80", I8080, 0x00, SCRIPT_S("G") },
+	{ "BAS4K32", I8080, 0x00,
+	  SCRIPT_S("\r\rY\r10 FOR I=1 TO 2000\r20 A=I*I/3\r30 NEXT I\r"
+		   "40 PRINT I\rRUN\r")
+	  SCRIPT_W("2001") },
+	{ "BAS8K40", I8080, 0x22,
+	  SCRIPT_S("\r\rY\r10 FOR I=1 TO 2000\r20 A=I*I/3\r30 NEXT I\r"
+		   "40 PRINT I\rRUN\r")
+	  SCRIPT_W("2001") },
+	{ "BAS16K40", I8080, 0x22,
+	  SCRIPT_S("\r\r10 FOR I=1 TO 2000\r20 A=I*I/3\r30 NEXT I\r"
+		   "40 PRINT I\rRUN\r")
+	  SCRIPT_W("2001") }
+};
+#define NUMBENCH (sizeof(benchs) / sizeof(benchs[0]))
+
+static enum script_end bench_end; /* why the last run ended */
+
+/*
+ *	clear the XIP cache counters
+ */
+static void xip_start(void)
+{
+#if !PICOSIM_HOST
+	xip_ctrl_hw->ctr_hit = 0;
+	xip_ctrl_hw->ctr_acc = 0;
+#endif
+}
+
+/*
+ *	XIP cache hit rate since xip_start() as text
+ */
+static const char *xip_hit(void)
+{
+#if PICOSIM_HOST
+	return "-";
+#else
+	static char buf[8];
+	uint32_t hit = xip_ctrl_hw->ctr_hit;
+	uint32_t acc = xip_ctrl_hw->ctr_acc;
+	unsigned pm;
+
+	if (acc == 0)
+		return "-";
+	pm = (unsigned) ((uint64_t) hit * 1000 / acc);
+	snprintf(buf, sizeof(buf), "%u.%u", pm / 10, pm % 10);
+	return buf;
+#endif
+}
+
+/*
+ *	run one program and print the result
+ */
+static void bench_one(const struct bench *b)
+{
+	struct script_result r;
+	const char *xip;
+
+#if defined(EXCLUDE_Z80) || defined(EXCLUDE_I8080)
+	if (cpu != b->cpu) {
+		printf("bench name=%s skipped=cpu\n", b->name);
+		return;
+	}
+#else
+	if (cpu != b->cpu)
+		switch_cpu(b->cpu);
+#endif
+	reset_cpu();
+	reset_memory();
+	if (!load_file(b->name, -1, &PC)) {
+		printf("bench name=%s skipped=file\n", b->name);
+		return;
+	}
+	fp_value = b->fp;
+
+	xip_start();
+	script_run(b->script, BENCH_TIMEOUT, NULL, &r);
+	xip = xip_hit();
+	bench_end = r.end;
+
+	printf("bench name=%s platform=%s clk_mhz=%d core=%s cpu=%s end=%s "
+	       "ok=%d tstates=%" PRIu64 " time_us=%" PRIu64 " mhz=%u.%02u "
+	       "xip_hit=%s out=%lu\n", b->name, BENCH_PLATFORM, sysclk_mhz(),
+	       BENCH_CORE, b->cpu == Z80 ? "z80" : "8080",
+	       script_end_names[r.end], r.done, (uint64_t) r.tstates, r.us,
+	       r.mhz / 100, r.mhz % 100, xip, r.out);
+}
+
+/*
+ *	run the benchmark 'name', or all if name is empty
+ */
+void bench_run(const char *name)
+{
+	register unsigned int i;
+	int save_cpu = cpu, save_f_value = f_value;
+	BYTE save_fp_value = fp_value;
+	bool found = false;
+#ifdef WANT_HB
+	bool save_hb_flag = hb_flag;
+
+	hb_flag = false;
+#endif
+	f_value = 0;		/* no speed limit */
+
+	for (i = 0; i < NUMBENCH; i++) {
+		if (*name && strcasecmp(name, benchs[i].name) != 0)
+			continue;
+		found = true;
+		bench_one(&benchs[i]);
+		if (bench_end == SCRIPT_USER)
+			break;
+	}
+	if (!found)
+		puts("no such benchmark");
+
+	f_value = save_f_value;
+	fp_value = save_fp_value;
+#if !defined(EXCLUDE_Z80) && !defined(EXCLUDE_I8080)
+	if (cpu != save_cpu)
+		switch_cpu(save_cpu);
+#else
+	UNUSED(save_cpu);
+#endif
+#ifdef WANT_HB
+	hb_flag = save_hb_flag;
+#endif
+}
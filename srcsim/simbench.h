@@ -0,0 +1,21 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Emulation speed benchmark with the example programs from CODE80,
+ * started with the ICE command "! bench".
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SIMBENCH_INC
+#define SIMBENCH_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+extern void bench_run(const char *name);
+
+#endif /* !SIMBENCH_INC */
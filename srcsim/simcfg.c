@@ -13,6 +13,16 @@
  * 28-MAY-2024 implemented mount/unmount of disk images
  * 03-JUN-2024 added directory list for code files and disk images
  * 24-MAY-2025 separate read/save config file from config and add network config
+ * 19-OCT-2026 added RAM disk configuration
+ * 19-OCT-2026 resume from snapshot
+ * 19-OCT-2026 added memory fill configuration
+ * 19-OCT-2026 load address for load file
+ * 19-OCT-2026 complete unique prefix of file names
+ * 19-OCT-2026 tagged config file format, saved only if changed
+ * 19-OCT-2026 no dialog in batch mode
+ * 19-OCT-2026 read-only USB mass storage while the machine runs
+ * 19-OCT-2026 selectable system clock
+ * 19-OCT-2026 address of the VDM-1 display memory
  */
 
 #include <stdlib.h>
@@ -35,10 +45,15 @@
 #include "simcore.h"
 #include "simport.h"
 #include "simio.h"
+#include "simmem.h"
 #include "simcfg.h"
 
 #include "disks.h"
+#include "snapshot.h"
+#include "simbatch.h"
 #include "picosim.h"
+#include "sysclk.h"
+#include "vdm.h"
 #if LIB_STDIO_MSC_USB
 #include "stdio_msc_usb.h"
 #endif
@@ -51,18 +66,38 @@
 static datetime_t t = { .year = 2024, .month = 1, .day = 1, .dotw = 1,
 			.hour = 0, .min = 0, .sec = 0 };
 static int brightness = 1000;
+static int msc_export;	/* export MicroSD read-only while running */
+static int sys_mhz;	/* system clock in MHz, 0 = SDK default */
 static const char *cfg = "/CONF80/" CONF_FILE;
+static const char *cfg_tmp = "/CONF80/" CONF_FILE ".TMP";
 
 /*
- * prompt for a filename
+ * prompt for a filename of a file with pattern 'ext' in directory 'dir',
+ * a unique prefix of the name is completed, if it isn't unique the
+ * matching files are listed and an empty name is returned
  */
-static void prompt_fn(char *s)
+static void prompt_fn(char *s, const char *dir, const char *ext)
 {
+	char name[FNLEN+1], pat[FNLEN+6];
+	char *p;
+	int n;
+
 	printf("Filename: ");
 	get_cmdline(s, FNLEN+1);
-	while (*s) {
-		*s = toupper((unsigned char) *s);
-		s++;
+	for (p = s; *p; p++)
+		*p = toupper((unsigned char) *p);
+	if (s[0] == '\0')
+		return;
+
+	n = find_files(dir, ext, s, name);
+	if (n == 1 && strcmp(s, name) != 0) {
+		strcpy(s, name);
+		printf("Filename: %s\n", s);
+	} else if (n > 1) {
+		strcpy(pat, s);
+		strcat(pat, ext);
+		list_files(dir, pat);
+		s[0] = '\0';
 	}
 }
 
@@ -90,58 +125,280 @@ static int get_int(const char *prompt, const char *hint,
 }
 
 /*
- * try to read config file
+ * get an address in hex, returns -1 if none entered
+ */
+static int get_addr(const char *prompt)
+{
+	char s[5], *end;
+	long addr;
+
+	for (;;) {
+		printf("Enter %s in Hex (empty=default): ", prompt);
+		get_cmdline(s, 5);
+		if (s[0] == '\0')
+			return -1;
+		addr = strtol(s, &end, 16);
+		if (*end == '\0' && addr >= 0 && addr <= 0xffff)
+			return (int) addr;
+		puts("Invalid address: range 0000 - FFFF");
+	}
+}
+
+/*
+ * The configuration file starts with a header of the magic "CF80" and
+ * the format version, followed by records of a tag byte, a 16 bit
+ * little endian length and the data of a variable, and ends with the
+ * CRC-32 of everything before it. Records with unknown tags are skipped
+ * and strings of another length are truncated, so that new settings can
+ * be added without breaking older files. The tags must never be changed
+ * or reused.
+ */
+#define CFG_MAGIC	"CF80"
+#define CFG_VERSION	1
+#define CFG_HDRLEN	5	/* magic + version */
+#define CFG_BUFSZ	512	/* max. size of the file */
+
+#define CFG_STR		0x01	/* variable is a string */
+#define CFG_NOCMP	0x02	/* change doesn't require a save */
+
+#define CFG_ITEMS(X) \
+	X(  1, 0, sizeof(cpu), &cpu) \
+	X(  2, 0, sizeof(speed), &speed) \
+	X(  3, 0, sizeof(fp_value), &fp_value) \
+	X(  4, 0, sizeof(brightness), &brightness) \
+	X(  5, CFG_NOCMP, sizeof(t), &t) \
+	X(  6, CFG_STR, sizeof(wifi_ssid), wifi_ssid) \
+	X(  7, CFG_STR, sizeof(wifi_password), wifi_password) \
+	X(  8, CFG_STR, sizeof(ntp_server), ntp_server) \
+	X(  9, 0, sizeof(utc_offset), &utc_offset) \
+	X( 10, CFG_STR, DISKLEN+1, disks[0]) \
+	X( 11, CFG_STR, DISKLEN+1, disks[1]) \
+	X( 12, CFG_STR, DISKLEN+1, disks[2]) \
+	X( 13, CFG_STR, DISKLEN+1, disks[3]) \
+	X( 14, 0, sizeof(ramdisk), &ramdisk) \
+	X( 15, 0, sizeof(ramdisk_flush), &ramdisk_flush) \
+	X( 16, 0, sizeof(mem_fill), &mem_fill) \
+	X( 17, 0, sizeof(msc_export), &msc_export) \
+	X( 18, 0, sizeof(sys_mhz), &sys_mhz) \
+	X( 19, 0, sizeof(vdm_addr), &vdm_addr)
+
+#define CFG_ITEM(tag, flags, len, var) { tag, flags, len, var },
+#define CFG_RECLEN(tag, flags, len, var) + 3 + (len)
+
+static const struct cfg_item {
+	BYTE tag;
+	BYTE flags;
+	WORD len;
+	void *var;
+} cfg_items[] = {
+	CFG_ITEMS(CFG_ITEM)
+};
+/* header, all records and CRC must fit into cfg_buf */
+_Static_assert(CFG_HDRLEN CFG_ITEMS(CFG_RECLEN) + 4 <= CFG_BUFSZ,
+	       "configuration records don't fit into CFG_BUFSZ");
+#define NUMCFG (sizeof(cfg_items) / sizeof(cfg_items[0]))
+
+static BYTE cfg_buf[CFG_BUFSZ];
+static uint32_t cfg_crc;	/* CRC of the settings in the file */
+static bool cfg_valid;		/* file exists in the current format */
+static bool cfg_force;		/* save, even if only the time changed */
+
+/*
+ * CRC-32 (IEEE 802.3) with a nibble table
+ */
+static uint32_t crc32(const BYTE *p, size_t len)
+{
+	static const uint32_t tab[16] = {
+		0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+		0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+		0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+		0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+	};
+	uint32_t crc = 0xffffffff;
+
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 4) ^ tab[crc & 0x0f];
+		crc = (crc >> 4) ^ tab[crc & 0x0f];
+	}
+	return ~crc;
+}
+
+/*
+ * build the configuration file in cfg_buf, without the items
+ * flagged CFG_NOCMP if all is false, returns the length
+ */
+static size_t cfg_build(bool all)
+{
+	register size_t n = CFG_HDRLEN;
+	register unsigned int i;
+	uint32_t crc;
+
+	memcpy(cfg_buf, CFG_MAGIC, 4);
+	cfg_buf[4] = CFG_VERSION;
+	for (i = 0; i < NUMCFG; i++) {
+		if (!all && (cfg_items[i].flags & CFG_NOCMP))
+			continue;
+		cfg_buf[n++] = cfg_items[i].tag;
+		cfg_buf[n++] = cfg_items[i].len & 0xff;
+		cfg_buf[n++] = cfg_items[i].len >> 8;
+		memcpy(&cfg_buf[n], cfg_items[i].var, cfg_items[i].len);
+		n += cfg_items[i].len;
+	}
+	crc = crc32(cfg_buf, n);
+	cfg_buf[n++] = crc & 0xff;
+	cfg_buf[n++] = (crc >> 8) & 0xff;
+	cfg_buf[n++] = (crc >> 16) & 0xff;
+	cfg_buf[n++] = crc >> 24;
+	return n;
+}
+
+/*
+ * read a config file in the format used before the tagged records,
+ * the variables in a fixed order
+ */
+static void read_config_old(void)
+{
+	unsigned int br;
+
+	f_lseek(&sd_file, 0);
+	f_read(&sd_file, &cpu, sizeof(cpu), &br);
+	f_read(&sd_file, &speed, sizeof(speed), &br);
+	f_read(&sd_file, &fp_value, sizeof(fp_value), &br);
+	f_read(&sd_file, &brightness, sizeof(brightness), &br);
+	f_read(&sd_file, &t, sizeof(t), &br);
+	f_read(&sd_file, &wifi_ssid, sizeof(wifi_ssid), &br);
+	f_read(&sd_file, &wifi_password, sizeof(wifi_password), &br);
+	f_read(&sd_file, &ntp_server, sizeof(ntp_server), &br);
+	f_read(&sd_file, &utc_offset, sizeof(utc_offset), &br);
+	f_read(&sd_file, &disks[0], DISKLEN+1, &br);
+	f_read(&sd_file, &disks[1], DISKLEN+1, &br);
+	f_read(&sd_file, &disks[2], DISKLEN+1, &br);
+	f_read(&sd_file, &disks[3], DISKLEN+1, &br);
+	f_read(&sd_file, &ramdisk, sizeof(ramdisk), &br);
+	f_read(&sd_file, &ramdisk_flush, sizeof(ramdisk_flush), &br);
+	f_read(&sd_file, &mem_fill, sizeof(mem_fill), &br);
+}
+
+/*
+ * parse the records of the configuration file in cfg_buf
+ * returns false if the file is corrupt
+ */
+static bool cfg_parse(size_t len)
+{
+	register size_t n = CFG_HDRLEN;
+	register unsigned int i;
+	uint32_t crc;
+	size_t rlen;
+	BYTE tag;
+
+	if (len < CFG_HDRLEN + 4 || cfg_buf[4] != CFG_VERSION)
+		return false;
+	len -= 4;
+	crc = cfg_buf[len] | (cfg_buf[len + 1] << 8) |
+	      (cfg_buf[len + 2] << 16) | ((uint32_t) cfg_buf[len + 3] << 24);
+	if (crc != crc32(cfg_buf, len))
+		return false;
+
+	while (n + 3 <= len) {
+		tag = cfg_buf[n];
+		rlen = cfg_buf[n + 1] | (cfg_buf[n + 2] << 8);
+		n += 3;
+		if (n + rlen > len)
+			return false;
+		for (i = 0; i < NUMCFG; i++)
+			if (cfg_items[i].tag == tag)
+				break;
+		if (i < NUMCFG) {
+			if (rlen == cfg_items[i].len)
+				memcpy(cfg_items[i].var, &cfg_buf[n], rlen);
+			else if (cfg_items[i].flags & CFG_STR) {
+				if (rlen >= cfg_items[i].len)
+					rlen = cfg_items[i].len - 1;
+				memcpy(cfg_items[i].var, &cfg_buf[n], rlen);
+				((char *) cfg_items[i].var)[rlen] = '\0';
+			}
+		}
+		n += rlen;
+	}
+	return true;
+}
+
+/*
+ * try to read config file, if it is missing a temporary
+ * file left by an interrupted save_config() is used
  */
 void read_config(void)
 {
+	const char *name = cfg;
 	unsigned int br;
+	size_t len;
 
-	sd_res = f_open(&sd_file, cfg, FA_READ);
+	sd_res = f_open(&sd_file, name, FA_READ);
+	if (sd_res != FR_OK) {
+		name = cfg_tmp;
+		sd_res = f_open(&sd_file, name, FA_READ);
+	}
 	if (sd_res == FR_OK) {
-		f_read(&sd_file, &cpu, sizeof(cpu), &br);
-		f_read(&sd_file, &speed, sizeof(speed), &br);
-		f_read(&sd_file, &fp_value, sizeof(fp_value), &br);
-		f_read(&sd_file, &brightness, sizeof(brightness), &br);
-		f_read(&sd_file, &t, sizeof(t), &br);
-		f_read(&sd_file, &wifi_ssid, sizeof(wifi_ssid), &br);
-		f_read(&sd_file, &wifi_password, sizeof(wifi_password), &br);
-		f_read(&sd_file, &ntp_server, sizeof(ntp_server), &br);
-		f_read(&sd_file, &utc_offset, sizeof(utc_offset), &br);
-		f_read(&sd_file, &disks[0], DISKLEN+1, &br);
-		f_read(&sd_file, &disks[1], DISKLEN+1, &br);
-		f_read(&sd_file, &disks[2], DISKLEN+1, &br);
-		f_read(&sd_file, &disks[3], DISKLEN+1, &br);
+		sd_res = f_read(&sd_file, cfg_buf, sizeof(cfg_buf), &br);
+		if (sd_res == FR_OK && br >= 4 &&
+		    memcmp(cfg_buf, CFG_MAGIC, 4) == 0) {
+			if (cfg_parse(br))
+				cfg_valid = (name == cfg);
+			else
+				printf("Config file %s is corrupt, using "
+				       "defaults\n", name);
+		} else if (sd_res == FR_OK && name == cfg)
+			read_config_old();
 		f_close(&sd_file);
 	}
 #if defined(EXCLUDE_I8080) || defined(EXCLUDE_Z80)
 	cpu = DEF_CPU;
 #endif
+	len = cfg_build(false);
+	cfg_crc = crc32(cfg_buf, len - 4);
+
+	/* set the clock before any file is opened, see sysclk_set() */
+	if (sys_mhz && !sysclk_set(sys_mhz))
+		sys_mhz = 0;
 }
 
 /*
- * try to save config file
+ * save config file, if any setting was changed,
+ * the file is replaced with a temporary file
  */
 void save_config(void)
 {
-	unsigned int br;
-
-	sd_res = f_open(&sd_file, cfg, FA_WRITE | FA_CREATE_ALWAYS);
+	unsigned int bw;
+	size_t len;
+
+	len = cfg_build(false);
+	if (cfg_valid && !cfg_force && crc32(cfg_buf, len - 4) == cfg_crc)
+		return;
+
+	len = cfg_build(true);	/* the file also has the RTC time */
+	sd_res = f_open(&sd_file, cfg_tmp, FA_WRITE | FA_CREATE_ALWAYS);
+	if (sd_res != FR_OK)
+		return;
+	sd_res = f_write(&sd_file, cfg_buf, len, &bw);
+	if (sd_res == FR_OK && bw != len)
+		sd_res = FR_DENIED;
+	if (f_close(&sd_file) != FR_OK && sd_res == FR_OK)
+		sd_res = FR_DISK_ERR;
 	if (sd_res == FR_OK) {
-		f_write(&sd_file, &cpu, sizeof(cpu), &br);
-		f_write(&sd_file, &speed, sizeof(speed), &br);
-		f_write(&sd_file, &fp_value, sizeof(fp_value), &br);
-		f_write(&sd_file, &brightness, sizeof(brightness), &br);
-		f_write(&sd_file, &t, sizeof(t), &br);
-		f_write(&sd_file, &wifi_ssid, sizeof(wifi_ssid), &br);
-		f_write(&sd_file, &wifi_password, sizeof(wifi_password), &br);
-		f_write(&sd_file, &ntp_server, sizeof(ntp_server), &br);
-		f_write(&sd_file, &utc_offset, sizeof(utc_offset), &br);
-		f_write(&sd_file, &disks[0], DISKLEN+1, &br);
-		f_write(&sd_file, &disks[1], DISKLEN+1, &br);
-		f_write(&sd_file, &disks[2], DISKLEN+1, &br);
-		f_write(&sd_file, &disks[3], DISKLEN+1, &br);
-		f_close(&sd_file);
+		f_unlink(cfg);
+		sd_res = f_rename(cfg_tmp, cfg);
+	}
+	if (sd_res != FR_OK) {
+		printf("can't save %s: %s (%d)\n", cfg,
+		       FRESULT_str(sd_res), sd_res);
+		f_unlink(cfg_tmp);
+		return;
 	}
+	len = cfg_build(false);
+	cfg_crc = crc32(cfg_buf, len - 4);
+	cfg_valid = true;
+	cfg_force = false;
 }
 
 #if defined(RASPBERRYPI_PICO_W)
@@ -208,12 +465,13 @@ void net_config(void)
 void config(void)
 {
 	const char *cpath = "/CODE80";
-	const char *cext = "*.BIN";
+	const char *cext = "*.*";
 	const char *dpath = "/DISKS80";
 	const char *dext = "*.DSK";
 	char s[FNLEN+1];
 	int go_flag = 0;
 	int i, n, menu;
+	WORD start;
 	static const char *dotw[7] = { "Sun", "Mon", "Tue", "Wed",
 				       "Thu", "Fri", "Sat" };
 
@@ -237,6 +495,9 @@ void config(void)
 
 	LCD_SetBackLight(brightness);
 
+	if (batch_active)	/* machine is set up by the batch script */
+		go_flag = 1;
+
 	menu = 1;
 
 	while (!go_flag) {
@@ -253,7 +514,10 @@ void config(void)
 			printf("t - set time\n");
 #if LIB_STDIO_MSC_USB
 			printf("u - enable USB mass storage access\n");
+			printf("x - USB mass storage while running: %s\n",
+			       msc_export ? "read-only" : "off");
 #endif
+			printf("k - system clock: %d MHz\n", sysclk_mhz());
 			printf("c - switch CPU, currently %s\n",
 			       (cpu == Z80) ? "Z80" : "8080");
 			printf("s - CPU speed: ");
@@ -262,6 +526,7 @@ void config(void)
 			else
 				printf("%d MHz\n", speed);
 			printf("p - Port 255 value: %02XH\n", fp_value);
+			printf("v - VDM-1 display memory: %04XH\n", vdm_addr);
 			printf("f - list files\n");
 			printf("r - load file\n");
 			printf("d - list disks\n");
@@ -269,6 +534,17 @@ void config(void)
 			printf("1 - Disk 1: %s\n", disks[1]);
 			printf("2 - Disk 2: %s\n", disks[2]);
 			printf("3 - Disk 3: %s\n", disks[3]);
+#ifdef RAMDISK
+			printf("m - RAM disk: ");
+			if (ramdisk < 0)
+				puts("none");
+			else
+				printf("drive %d, write back after %d s\n",
+				       ramdisk, ramdisk_flush);
+#endif
+			printf("z - memory at power on: %s\n",
+			       (mem_fill == MEM_ZERO) ? "zeroed" : "random");
+			printf("l - resume from snapshot\n");
 			printf("g - run machine\n\n");
 		} else
 			menu = 1;
@@ -313,6 +589,7 @@ void config(void)
 			if (n > 0) {
 				rtc_set_datetime(&t);
 				sleep_us(64);
+				cfg_force = true;
 			}
 			putchar('\n');
 			break;
@@ -335,6 +612,7 @@ void config(void)
 			if (n > 0) {
 				rtc_set_datetime(&t);
 				sleep_us(64);
+				cfg_force = true;
 			}
 			putchar('\n');
 			break;
@@ -348,8 +626,18 @@ void config(void)
 			init_disks();
 			check_disks();
 			break;
+
+		case 'x':
+			msc_export = !msc_export;
+			break;
 #endif
 
+		case 'k':
+			i = sysclk_next(sysclk_mhz());
+			if (sysclk_set(i))
+				sys_mhz = i;
+			break;
+
 		case 'c':
 			if (cpu == Z80)
 				switch_cpu(I8080);
@@ -384,6 +672,17 @@ again:
 			putchar('\n');
 			break;
 
+		case 'v':
+			if ((i = get_addr("display memory address")) < 0)
+				i = VDM_ADDR;
+			if (i & 0x3ff)
+				puts("Invalid address: must be a multiple of "
+				     "0400H");
+			else
+				vdm_addr = i;
+			putchar('\n');
+			break;
+
 		case 'f':
 			list_files(cpath, cext);
 			putchar('\n');
@@ -391,9 +690,14 @@ again:
 			break;
 
 		case 'r':
-			prompt_fn(s);
-			if (s[0])
-				load_file(s);
+			prompt_fn(s, cpath, cext);
+			/* .HEX files carry their own load addresses */
+			if (s[0] && load_file(s, get_addr("load address "
+					      "(ignored for .HEX)"), &start) &&
+			    start != 0)
+				/* the boot ROM runs code @ 0000H if there */
+				/* is no disk, else start it directly */
+				PC = start;
 			putchar('\n');
 			break;
 
@@ -408,7 +712,7 @@ again:
 		case '2':
 		case '3':
 			i = s[0] - '0';
-			prompt_fn(s);
+			prompt_fn(s, dpath, dext);
 			if (s[0])
 				mount_disk(i, s);
 			else {
@@ -417,6 +721,31 @@ again:
 			}
 			break;
 
+#ifdef RAMDISK
+		case 'm':
+			ramdisk = get_int("drive", " for RAM disk (empty=none)",
+					  0, 3);
+			if (ramdisk >= 0 &&
+			    (i = get_int("seconds", " until write back "
+					 "(0=on exit)", 0, 3600)) >= 0)
+				ramdisk_flush = i;
+			putchar('\n');
+			break;
+#endif
+
+		case 'z':
+			/* takes effect at the next power on, so that a
+			   program loaded with r isn't wiped */
+			mem_fill = (mem_fill == MEM_ZERO) ? MEM_TRASH : MEM_ZERO;
+			break;
+
+		case 'l':
+			if (load_snapshot())
+				go_flag = 1;
+			else
+				putchar('\n');
+			break;
+
 		case 'g':
 			go_flag = 1;
 			break;
@@ -426,4 +755,8 @@ again:
 		}
 	}
 
+#if LIB_STDIO_MSC_USB
+	if (msc_export)
+		stdio_msc_usb_start_concurrent_msc();
+#endif
 }
@@ -14,6 +14,11 @@
  * 08-JUN-2024 implemented system reset
  * 09-JUN-2024 implemented boot ROM
  * 29-JUN-2024 implemented banked memory
+ * 19-OCT-2026 added FDC disk geometry query port
+ * 19-OCT-2026 SIO can be connected to the benchmark
+ * 19-OCT-2026 SIO can be connected to the batch script
+ * 19-OCT-2026 SIO publishes the CPU registers for the LCD
+ * 19-OCT-2026 added VDM-1 control port
  */
 
 /* Raspberry SDK includes */
@@ -37,9 +42,14 @@
 #include "simio.h"
 
 #include "dazzler.h"
+#include "vdm.h"
 #include "rtc80.h"
 #include "sd-fdc.h"
+#include "ff.h"
+#include "disks.h"
 #include "rgbled.h"
+#include "simscript.h"
+#include "cpusnap.h"
 
 /*
  *	Forward declarations of the I/O functions
@@ -50,10 +60,14 @@ static void hwctl_out(BYTE data);
 static BYTE p000_in(void), p001_in(void), p255_in(void), hwctl_in(void);
 static void mmu_out(BYTE data);
 static BYTE mmu_in(void);
+static void fdcg_out(BYTE data);
+static BYTE fdcg_in(void);
 
 static BYTE sio_last;	/* last character received */
        BYTE fp_value;	/* port 255 value, can be set from ICE or config() */
 static BYTE hwctl_lock = 0xff; /* lock status hardware control port */
+static BYTE fdcg_buf[4];	/* disk geometry for the FDC query port */
+static int fdcg_idx;		/* next byte to read from fdcg_buf */
 
 /*
  *	This array contains function pointers for every input
@@ -63,6 +77,7 @@ BYTE (*const port_in[256])(void) = {
 	[  0] = p000_in,	/* SIO status */
 	[  1] = p001_in,	/* SIO data */
 	[  4] = fdc_in,		/* FDC status */
+	[  5] = fdcg_in,	/* FDC disk geometry */
 	[ 14] = dazzler_flags_in, /* Cromemco Dazzler flags */
 	[ 64] = mmu_in,		/* MMU */
 	[ 65] = clkc_in,	/* RTC read clock command */
@@ -79,12 +94,14 @@ void (*const port_out[256])(BYTE data) = {
 	[  0] = p000_out,	/* RGB LED */
 	[  1] = p001_out,	/* SIO data */
 	[  4] = fdc_out,	/* FDC command */
+	[  5] = fdcg_out,	/* FDC select drive for geometry */
 	[ 14] = dazzler_ctl_out, /* Cromemco Dazzler control */
 	[ 15] = dazzler_format_out, /* Cromemco Dazzler format */
 	[ 64] = mmu_out,	/* MMU */
 	[ 65] = clkc_out,	/* RTC write clock command */
 	[ 66] = clkd_out,	/* RTC write clock data */
 	[160] = hwctl_out,	/* virtual hardware control */
+	[200] = vdm_ctl_out,	/* Processor Technology VDM-1 control */
 	[255] = p255_out	/* for frontpanel */
 };
 
@@ -107,6 +124,12 @@ static BYTE p000_in(void)
 {
 	register BYTE stat = 0b10000001; /* initially not ready */
 
+	cpu_snap_tick();	/* programs poll the status most of the time */
+	disks_tick();		/* write back the RAM disk while idle */
+
+	if (script_active)
+		return script_stat();
+
 #if LIB_PICO_STDIO_UART
 	uart_inst_t *my_uart = uart_default;
 
@@ -135,6 +158,11 @@ static BYTE p001_in(void)
 {
 	int input_avail = 0;
 
+	cpu_snap_tick();
+
+	if (script_active)
+		return script_in();
+
 #if LIB_PICO_STDIO_UART
 	uart_inst_t *my_uart = uart_default;
 
@@ -169,6 +197,22 @@ static BYTE mmu_in(void)
 	return selbnk;
 }
 
+/*
+ *	I/O function port 5 read:
+ *	successive reads return the geometry of the drive
+ *	selected with a write to this port:
+ *	disk type (0 = no disk, 1 = 8" SSSD, 2 = 4 MB HD, 3 = 8 MB HD),
+ *	last track, sectors per track, sector size in 128 byte units,
+ *	all four bytes are 0 if there is no disk in the drive
+ */
+static BYTE fdcg_in(void)
+{
+	BYTE data = fdcg_buf[fdcg_idx];
+
+	fdcg_idx = (fdcg_idx + 1) & 3;
+	return data;
+}
+
 /*
  *	I/O function port 255 read:
  *	used by frontpanel machines
@@ -201,6 +245,12 @@ static void p000_out(BYTE data)
  */
 static void p001_out(BYTE data)
 {
+	cpu_snap_tick();
+
+	if (script_active) {
+		script_out(data);
+		return;
+	}
 	putchar_raw((int) data & 0x7f); /* strip parity, some software won't */
 }
 
@@ -265,6 +315,21 @@ static void mmu_out(BYTE data)
 	selbnk = data;
 }
 
+/*
+ *	I/O function port 5 write:
+ *	select drive for the disk geometry query
+ */
+static void fdcg_out(BYTE data)
+{
+	int trk, spt, secsz;
+
+	fdcg_buf[0] = disk_geom(data, &trk, &spt, &secsz);
+	fdcg_buf[1] = fdcg_buf[0] ? trk - 1 : 0;
+	fdcg_buf[2] = spt;
+	fdcg_buf[3] = secsz / 128;
+	fdcg_idx = 0;
+}
+
 /*
  *	This allows to set the frontpanel port with ICE p command
  */
@@ -10,9 +10,11 @@
  * 09-JUN-2024 implemented boot ROM
  * 28-JUN-2024 added second memory bank
  * 29-JUN-2024 implemented banked memory
+ * 19-OCT-2026 fast memory fill, optional zeroed memory
  */
 
-#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "sim.h"
 #include "simdefs.h"
@@ -24,11 +26,33 @@ BYTE bnk0[65536];
 BYTE bnk1[49152];
 /* selected bank */
 BYTE selbnk;
+/* memory contents after power on */
+int mem_fill = MEM_TRASH;
 
 /* boot ROM code */
 #define MEMSIZE 256
 #include "bootrom.c"
 
+/*
+ * fill n bytes with pseudo random numbers from a xorshift generator,
+ * a word at a time, n must be a multiple of 4
+ */
+static void fill_trash(BYTE *p, size_t n)
+{
+	static uint32_t x = 2463534242U;
+	uint32_t w = x;
+	register BYTE *end = p + n;
+
+	while (p < end) {
+		w ^= w << 13;
+		w ^= w >> 17;
+		w ^= w << 5;
+		memcpy(p, &w, sizeof(w));
+		p += sizeof(w);
+	}
+	x = w;
+}
+
 void init_memory(void)
 {
 	register int i;
@@ -37,11 +61,14 @@ void init_memory(void)
 	for (i = 0; i < MEMSIZE; i++)
 		bnk0[0xff00 + i] = code[i];
 
-	/* trash memory like in a real machine after power on */
-	for (i = 0; i < 0xff00; i++)
-		bnk0[i] = rand() % 256;
-	for (i = 0; i < 0xc000; i++)
-		bnk1[i] = rand() % 256;
+	if (mem_fill == MEM_ZERO) {
+		memset(bnk0, 0, 0xff00);
+		memset(bnk1, 0, sizeof(bnk1));
+	} else {
+		/* trash memory like in a real machine after power on */
+		fill_trash(bnk0, 0xff00);
+		fill_trash(bnk1, sizeof(bnk1));
+	}
 }
 
 void reset_memory(void)
@@ -8,6 +8,7 @@
  * History:
  * 23-APR-2024 derived from z80sim
  * 29-JUN-2024 implemented banked memory
+ * 19-OCT-2026 optional zeroed memory
  */
 
 #ifndef SIMMEM_INC
@@ -19,6 +20,10 @@
 extern BYTE bnk0[65536], bnk1[49152];
 extern BYTE selbnk;
 
+#define MEM_TRASH 0	/* memory filled with random values at power on */
+#define MEM_ZERO 1	/* memory zeroed at power on */
+extern int mem_fill;
+
 extern void init_memory(void), reset_memory(void);
 
 /* Last page in memory is ROM and write protected. Some software */
@@ -9,8 +9,14 @@
 
 #include <stdint.h>
 #include "pico/time.h"
+#include "cpusnap.h"
 
-static inline void sleep_for_us(long time) { sleep_us(time); }
+/* the CPU sleeps between instructions, when the speed is limited */
+static inline void sleep_for_us(long time)
+{
+	cpu_snap_publish();
+	sleep_us(time);
+}
 static inline void sleep_for_ms(int time) { sleep_ms(time); }
 
 static inline uint64_t get_clock_us(void)
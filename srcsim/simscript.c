@@ -0,0 +1,201 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * SIO script engine for the benchmark and the batch mode. While a
+ * script runs, the SIO is connected to it instead of the terminal.
+ * The steps are executed in order: a send step feeds its text as
+ * keystrokes into the SIO, a wait step waits until its text was
+ * output. The CPU runs until:
+ *
+ *	halt	the program executed HALT or halted via the I/O port
+ *	idle	no keystrokes are pending and the program polls
+ *		the SIO status in a tight loop, waiting for input
+ *	timeout	the timeout expired
+ *	user	interrupted with the User Key
+ *
+ * History:
+ * 19-OCT-2026 first version
+ * 19-OCT-2026 idle loop detection covers the CP/M 3 BIOS
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simcore.h"
+
+#include "simscript.h"
+
+/*
+ * A status poll counts as idle, if it comes less than SCRIPT_IDLE_T
+ * after the previous one. The console input loops of the BIOSes poll
+ * every 24 T states (CP/M 2.2 CONST/CONIN) and every 101 (8080) or
+ * 102 (Z80) T states (CP/M 3 banked BIOS CONIN with TTY1IS), the limit
+ * leaves room for slower loops. Programs which poll for ^C while they
+ * compute do so every few thousand T states and don't look idle.
+ */
+#define SCRIPT_IDLE_T	500	/* T states between polls of an idle loop */
+#define SCRIPT_IDLE_N	100	/* number of such polls until idle */
+
+bool script_active;		/* SIO is connected to the script */
+
+const char *const script_end_names[] = {
+	"run", "halt", "idle", "timeout", "user"
+};
+
+static const char *step;	/* current step */
+static const char *input;	/* next keystroke of a send step */
+static char out_tail[SCRIPT_WAITLEN]; /* last characters of the output */
+static BYTE last_in;		/* last keystroke read */
+static unsigned long out_cnt;	/* number of characters output */
+static Tstates_t poll_T;	/* T states at last status poll */
+static int idle_n;		/* number of fast polls in a row */
+static enum script_end script_end; /* why the run ended */
+static void (*script_echo)(BYTE data); /* where the output goes */
+
+/*
+ * append a step to the script in buf with size bytes, pos is the
+ * end of the script so far, returns false if the text doesn't fit
+ */
+bool script_add(char *buf, size_t size, size_t *pos, char type,
+		const char *text)
+{
+	size_t n = strlen(text);
+
+	if (n == 0 || (type == SCRIPT_WAIT && n >= SCRIPT_WAITLEN))
+		return false;
+	if (*pos + n + 3 > size)
+		return false;
+	buf[(*pos)++] = type;
+	strcpy(&buf[*pos], text);
+	*pos += n + 1;
+	buf[*pos] = '\0';
+	return true;
+}
+
+/*
+ * start the step at s
+ */
+static void start_step(const char *s)
+{
+	step = s;
+	input = (*step == SCRIPT_SEND) ? step + 1 : "";
+	memset(out_tail, 0, sizeof(out_tail));
+	idle_n = 0;
+}
+
+/*
+ *	SIO status for the machine, input is available
+ *	while a send step is executed
+ */
+BYTE script_stat(void)
+{
+	if (*input)
+		return 0x00;	/* input available, ready for output */
+
+	if (T - poll_T < SCRIPT_IDLE_T) {
+		if (++idle_n >= SCRIPT_IDLE_N) {
+			script_end = SCRIPT_IDLE;
+			cpu_state = ST_STOPPED;
+		}
+	} else
+		idle_n = 0;
+	poll_T = T;
+
+	return 0x01;		/* no input, ready for output */
+}
+
+/*
+ *	SIO data input for the machine
+ */
+BYTE script_in(void)
+{
+	if (*input) {
+		last_in = (BYTE) *input++;
+		if (*input == '\0')
+			start_step(step + strlen(step) + 1);
+	}
+	idle_n = 0;
+	return last_in;
+}
+
+/*
+ *	SIO data output of the machine, compared with the wait text
+ */
+void script_out(BYTE data)
+{
+	size_t n;
+
+	data &= 0x7f;
+	if (script_echo != NULL)
+		(*script_echo)(data);
+	out_cnt++;
+	idle_n = 0;
+	if (*step != SCRIPT_WAIT)
+		return;
+
+	memmove(out_tail, out_tail + 1, SCRIPT_WAITLEN - 2);
+	out_tail[SCRIPT_WAITLEN - 2] = data;
+	n = strlen(step + 1);
+	if (memcmp(&out_tail[SCRIPT_WAITLEN - 1 - n], step + 1, n) == 0)
+		start_step(step + n + 2);
+}
+
+/*
+ *	This function is the callback for the alarm.
+ *	The CPU emulation is stopped here.
+ */
+static int64_t script_timeout(alarm_id_t id, void *user_data)
+{
+	UNUSED(id);
+	UNUSED(user_data);
+
+	script_end = SCRIPT_TIMEOUT;
+	cpu_state = ST_STOPPED;
+	return 0;
+}
+
+/*
+ * run the machine with the script steps, the output is passed to echo
+ * if it isn't NULL, the result of the run is returned in r
+ */
+void script_run(const char *steps, uint32_t timeout_ms,
+		void (*echo)(BYTE data), struct script_result *r)
+{
+	uint64_t t0, t1;
+	Tstates_t T0;
+	alarm_id_t alarm;
+
+	start_step(steps);
+	script_echo = echo;
+	last_in = 0;
+	out_cnt = 0;
+	poll_T = T;
+	script_end = SCRIPT_RUN;
+	cpu_error = NONE;
+
+	script_active = true;
+	alarm = add_alarm_in_ms(timeout_ms, script_timeout, NULL, true);
+	T0 = T;
+	t0 = to_us_since_boot(get_absolute_time());
+	run_cpu();
+	t1 = to_us_since_boot(get_absolute_time());
+	if (alarm > 0)
+		cancel_alarm(alarm);
+	script_active = false;
+
+	if (script_end == SCRIPT_RUN)
+		script_end = (cpu_error == USERINT) ? SCRIPT_USER
+						    : SCRIPT_HALT;
+	r->end = script_end;
+	r->done = (*step == '\0');
+	r->tstates = T - T0;
+	r->us = t1 - t0;
+	r->mhz = r->us ? (unsigned) (r->tstates * 100 / r->us) : 0;
+	r->out = out_cnt;
+}
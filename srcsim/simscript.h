@@ -0,0 +1,54 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * SIO script engine, runs the machine with keystrokes fed into the
+ * SIO and text expected in the output, used by the benchmark and
+ * the batch mode.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SIMSCRIPT_INC
+#define SIMSCRIPT_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define SCRIPT_WAIT	'W'	/* step: wait until text is output */
+#define SCRIPT_SEND	'S'	/* step: send text as keystrokes */
+#define SCRIPT_WAITLEN	32	/* max. length of wait text + 1 */
+
+/*
+ * A script is a sequence of steps, each is the type character followed
+ * by the NUL terminated text, the script ends with an empty step.
+ * Scripts in the program can be written as string literals with:
+ */
+#define SCRIPT_W(text)	"W" text "\0"
+#define SCRIPT_S(text)	"S" text "\0"
+
+enum script_end { SCRIPT_RUN, SCRIPT_HALT, SCRIPT_IDLE, SCRIPT_TIMEOUT,
+		  SCRIPT_USER };
+
+struct script_result {
+	enum script_end end;	/* why the run ended */
+	bool done;		/* all steps were executed */
+	Tstates_t tstates;	/* T states executed */
+	uint64_t us;		/* run time in us */
+	unsigned mhz;		/* emulated clock in 1/100 MHz */
+	unsigned long out;	/* number of characters output */
+};
+
+extern bool script_active;
+extern const char *const script_end_names[];
+
+extern bool script_add(char *buf, size_t size, size_t *pos, char type,
+		       const char *text);
+extern void script_run(const char *steps, uint32_t timeout_ms,
+		       void (*echo)(BYTE data), struct script_result *r);
+extern BYTE script_stat(void), script_in(void);
+extern void script_out(BYTE data);
+
+#endif /* !SIMSCRIPT_INC */
@@ -0,0 +1,390 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * This module saves the state of the machine into a snapshot file
+ * on MicroSD and restores it, so that a session can be resumed
+ * without running the boot ROM and booting the OS from disk again.
+ *
+ * The snapshot contains the CPU registers, MMU, port 255 value,
+ * Dazzler and VDM-1 registers, RTC, the address of the FDC command
+ * block set by the BIOS, the mounted disk images and both memory
+ * banks. The memory is compressed with a simple LZ77 scheme, a
+ * token byte < 0x80 is followed by token + 1 literal bytes, a
+ * token >= 0x80 is a match of (token & 0x7f) + 3 bytes at the
+ * 16 bit little endian distance following it.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ * 19-OCT-2026 state of the VDM-1
+ * 19-OCT-2026 cold start instead of panic with a corrupt snapshot
+ * 19-OCT-2026 address of the FDC command block
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "hardware/rtc.h"
+#include "pico/stdlib.h"
+
+#include "f_util.h"
+#include "ff.h"
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simcore.h"
+#include "simio.h"
+#include "sd-fdc.h"
+
+#include "disks.h"
+#include "dazzler.h"
+#include "vdm.h"
+#include "snapshot.h"
+
+#define SNAP_MAGIC	"SNP3"	/* 4 bytes at start of snapshot file */
+#define LZ_MINMATCH	3	/* shortest match */
+#define LZ_MAXMATCH	(0x7f + LZ_MINMATCH) /* longest match */
+#define LZ_MAXLIT	0x80	/* longest literal run */
+#define LZ_HBITS	10	/* size of hash table as power of 2 */
+#define LZ_NONE		0xffff	/* empty hash table entry */
+
+/* what snap_state() does with the state variables */
+enum snap_mode { SNAP_COUNT, SNAP_SAVE, SNAP_LOAD };
+
+/* state of a disk image, to detect changes after the snapshot */
+struct snap_dsk {
+	FSIZE_t fsize;
+	WORD fdate;
+	WORD ftime;
+};
+
+/* state not kept in variables which can be saved directly */
+static int snap_cpu;
+static BYTE snap_dzctl, snap_dzfmt;
+static int snap_vdm;
+static BYTE snap_vdmctl;
+static datetime_t snap_t;
+static struct snap_dsk snap_dsk[NUMDISK];
+
+/* buffered I/O to the snapshot file */
+static BYTE __aligned(4) snap_buf[512];
+static UINT snap_n, snap_pos;
+static uint32_t snap_len;		/* bytes counted with SNAP_COUNT */
+static bool snap_err;
+
+static uint16_t lz_hash[1 << LZ_HBITS];
+
+static void snap_flush(void)
+{
+	UINT bw;
+
+	if (snap_n > 0 && !snap_err) {
+		if (f_write(&sd_file, snap_buf, snap_n, &bw) != FR_OK ||
+		    bw != snap_n)
+			snap_err = true;
+	}
+	snap_n = 0;
+}
+
+static inline void snap_put(BYTE data)
+{
+	snap_buf[snap_n++] = data;
+	if (snap_n == sizeof(snap_buf))
+		snap_flush();
+}
+
+static inline int snap_get(void)
+{
+	if (snap_pos == snap_n) {
+		snap_pos = 0;
+		if (snap_err || f_read(&sd_file, snap_buf, sizeof(snap_buf),
+				       &snap_n) != FR_OK || snap_n == 0) {
+			snap_n = 0;
+			snap_err = true;
+			return -1;
+		}
+	}
+	return snap_buf[snap_pos++];
+}
+
+/*
+ * save, load or count the bytes of a state variable
+ */
+static void snap_var(enum snap_mode mode, void *p, size_t len)
+{
+	BYTE *s = (BYTE *) p;
+	int c;
+
+	switch (mode) {
+	case SNAP_COUNT:
+		snap_len += len;
+		break;
+	case SNAP_SAVE:
+		while (len--)
+			snap_put(*s++);
+		break;
+	case SNAP_LOAD:
+		while (len--) {
+			if ((c = snap_get()) < 0)
+				break;
+			*s++ = (BYTE) c;
+		}
+		break;
+	}
+}
+
+#define SNAP(x) snap_var(mode, &(x), sizeof(x))
+
+/*
+ * all state of the machine except memory
+ */
+static void snap_state(enum snap_mode mode)
+{
+	SNAP(snap_cpu);
+	SNAP(A); SNAP(B); SNAP(C); SNAP(D); SNAP(E); SNAP(H); SNAP(L);
+	SNAP(F); SNAP(SP); SNAP(PC); SNAP(IFF);
+#ifndef EXCLUDE_Z80
+	SNAP(A_); SNAP(B_); SNAP(C_); SNAP(D_); SNAP(E_); SNAP(H_); SNAP(L_);
+	SNAP(F_); SNAP(IX); SNAP(IY); SNAP(I); SNAP(R); SNAP(R_);
+	SNAP(int_mode);
+#endif
+	SNAP(selbnk);
+	SNAP(fp_value);
+	SNAP(snap_dzctl);
+	SNAP(snap_dzfmt);
+	SNAP(snap_vdm);
+	SNAP(snap_vdmctl);
+	SNAP(fdc_cmd_addr);
+	SNAP(snap_t);
+	SNAP(disks);
+	SNAP(snap_dsk);
+	SNAP(ramdisk);
+	SNAP(ramdisk_flush);
+}
+
+/*
+ * get size and time stamp of the mounted disk images
+ */
+static void snap_disks(struct snap_dsk *d)
+{
+	FILINFO fno;
+	register int i;
+
+	memset(d, 0, sizeof(struct snap_dsk) * NUMDISK);
+	for (i = 0; i < NUMDISK; i++)
+		if (disks[i][0] && f_stat(disks[i], &fno) == FR_OK) {
+			d[i].fsize = fno.fsize;
+			d[i].fdate = fno.fdate;
+			d[i].ftime = fno.ftime;
+		}
+}
+
+static void lz_literals(const BYTE *src, size_t n)
+{
+	size_t k;
+
+	while (n > 0) {
+		k = (n > LZ_MAXLIT) ? LZ_MAXLIT : n;
+		snap_put(k - 1);
+		n -= k;
+		while (k--)
+			snap_put(*src++);
+	}
+}
+
+/*
+ * compress len bytes at src into the snapshot file, len <= 64 KB
+ */
+static void lz_compress(const BYTE *src, size_t len)
+{
+	register size_t i = 0, n;
+	size_t lit = 0;
+	unsigned int h, cand;
+
+	memset(lz_hash, 0xff, sizeof(lz_hash));
+
+	while (i + LZ_MINMATCH <= len) {
+		h = ((src[i] << 6) ^ (src[i + 1] << 3) ^ src[i + 2]) &
+		    ((1 << LZ_HBITS) - 1);
+		cand = lz_hash[h];
+		lz_hash[h] = i;
+		if (cand != LZ_NONE && src[cand] == src[i] &&
+		    src[cand + 1] == src[i + 1] &&
+		    src[cand + 2] == src[i + 2]) {
+			n = LZ_MINMATCH;
+			while (n < LZ_MAXMATCH && i + n < len &&
+			       src[cand + n] == src[i + n])
+				n++;
+			lz_literals(&src[lit], i - lit);
+			snap_put(0x80 | (n - LZ_MINMATCH));
+			snap_put((i - cand) & 0xff);
+			snap_put((i - cand) >> 8);
+			i += n;
+			lit = i;
+		} else
+			i++;
+	}
+	lz_literals(&src[lit], len - lit);
+}
+
+/*
+ * decompress len bytes from the snapshot file to dst
+ * returns false if the data is corrupt
+ */
+static bool lz_decompress(BYTE *dst, size_t len)
+{
+	register size_t pos = 0, n;
+	size_t dist;
+	int c, d0, d1;
+
+	while (pos < len) {
+		if ((c = snap_get()) < 0)
+			return false;
+		if (c < 0x80) {
+			n = c + 1;
+			if (pos + n > len)
+				return false;
+			while (n--) {
+				if ((c = snap_get()) < 0)
+					return false;
+				dst[pos++] = c;
+			}
+		} else {
+			n = (c & 0x7f) + LZ_MINMATCH;
+			if ((d0 = snap_get()) < 0 || (d1 = snap_get()) < 0)
+				return false;
+			dist = d0 | (d1 << 8);
+			if (dist == 0 || dist > pos || pos + n > len)
+				return false;
+			while (n--) {
+				dst[pos] = dst[pos - dist];
+				pos++;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * save the machine state into the snapshot file
+ */
+bool save_snapshot(void)
+{
+	uint64_t t0 = to_us_since_boot(get_absolute_time());
+	FSIZE_t size;
+
+	snap_cpu = cpu;
+	dazzler_get_state(&snap_dzctl, &snap_dzfmt);
+	vdm_get_state(&snap_vdm, &snap_vdmctl);
+	rtc_get_datetime(&snap_t);
+	snap_disks(snap_dsk);
+	snap_len = 0;
+	snap_state(SNAP_COUNT);
+
+	sd_res = f_open(&sd_file, SNAPFILE, FA_WRITE | FA_CREATE_ALWAYS);
+	if (sd_res != FR_OK) {
+		printf("can't create %s: %s (%d)\n", SNAPFILE,
+		       FRESULT_str(sd_res), sd_res);
+		return false;
+	}
+	snap_n = 0;
+	snap_err = false;
+	snap_var(SNAP_SAVE, SNAP_MAGIC, 4);
+	snap_var(SNAP_SAVE, &snap_len, sizeof(snap_len));
+	snap_state(SNAP_SAVE);
+	lz_compress(bnk0, 0xff00);	/* without the boot ROM */
+	lz_compress(bnk1, sizeof(bnk1));
+	snap_flush();
+	size = f_size(&sd_file);
+	f_close(&sd_file);
+
+	if (snap_err) {
+		printf("error writing %s\n", SNAPFILE);
+		f_unlink(SNAPFILE);
+		return false;
+	}
+	printf("saved snapshot %s (%lu bytes) in %lu ms\n", SNAPFILE,
+	       (unsigned long) size, (unsigned long)
+	       ((to_us_since_boot(get_absolute_time()) - t0) / 1000));
+	return true;
+}
+
+/*
+ * restore the machine state from the snapshot file
+ */
+bool load_snapshot(void)
+{
+	char magic[4];
+	uint32_t len;
+	struct snap_dsk dsk[NUMDISK];
+	char old_disks[NUMDISK][DISKLEN+1];
+	int old_ramdisk = ramdisk, old_flush = ramdisk_flush;
+	BYTE old_fp = fp_value;
+	int old_fdc = fdc_cmd_addr;
+	register int i;
+
+	sd_res = f_open(&sd_file, SNAPFILE, FA_READ);
+	if (sd_res != FR_OK) {
+		puts("No snapshot found");
+		return false;
+	}
+	snap_n = snap_pos = 0;
+	snap_err = false;
+	snap_len = 0;
+	snap_state(SNAP_COUNT);
+	snap_var(SNAP_LOAD, magic, sizeof(magic));
+	snap_var(SNAP_LOAD, &len, sizeof(len));
+	if (snap_err || memcmp(magic, SNAP_MAGIC, sizeof(magic)) != 0 ||
+	    len != snap_len) {
+		f_close(&sd_file);
+		puts("Snapshot doesn't match this firmware");
+		return false;
+	}
+	memcpy(old_disks, disks, sizeof(old_disks));
+	snap_state(SNAP_LOAD);
+	if (snap_err || !lz_decompress(bnk0, 0xff00) ||
+	    !lz_decompress(bnk1, sizeof(bnk1))) {
+		f_close(&sd_file);
+		printf("Snapshot %s is corrupt\n", SNAPFILE);
+		/* registers and memory are garbage now, cold start */
+		memcpy(disks, old_disks, sizeof(old_disks));
+		ramdisk = old_ramdisk;
+		ramdisk_flush = old_flush;
+		fp_value = old_fp;
+		fdc_cmd_addr = old_fdc;
+		reset_cpu();
+		reset_memory();
+		init_memory();
+		PC = 0xff00;
+		return false;
+	}
+	f_close(&sd_file);
+
+#if !defined(EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
+	if (snap_cpu != cpu)
+		switch_cpu(snap_cpu);
+#endif
+	dazzler_ctl_out(snap_dzctl);
+	dazzler_format_out(snap_dzfmt);
+	vdm_set_state(snap_vdm, snap_vdmctl);
+	/* the BIOS set the FDC command address at boot, which is skipped */
+	if (fdc_cmd_addr >= 0) {
+		fdc_out(0x10);
+		fdc_out(fdc_cmd_addr & 0xff);
+		fdc_out(fdc_cmd_addr >> 8);
+	}
+	rtc_set_datetime(&snap_t);
+	sleep_us(64);
+
+	snap_disks(dsk);
+	for (i = 0; i < NUMDISK; i++)
+		if (memcmp(&dsk[i], &snap_dsk[i], sizeof(dsk[i])) != 0)
+			printf("Disk %d: image %s was changed after the "
+			       "snapshot\n", i, disks[i]);
+
+	puts("resuming from snapshot\n");
+	return true;
+}
@@ -0,0 +1,21 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Snapshot of the machine state on MicroSD, to resume a session
+ * without booting the OS again.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SNAPSHOT_INC
+#define SNAPSHOT_INC
+
+#define SNAPFILE "/CONF80/SNAPSHOT.DAT"
+
+extern bool save_snapshot(void);
+extern bool load_snapshot(void);
+
+#endif /* !SNAPSHOT_INC */
@@ -0,0 +1,137 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * This module changes the system clock at run time. The emulated
+ * CPU runs on clk_sys, so a faster clock raises the max. speed of
+ * the emulation directly.
+ *
+ * After a change of clk_sys the SDK clocks clk_peri from the USB PLL
+ * with 48 MHz, which is too slow for the LCD. Here clk_peri is clocked
+ * from clk_sys again, like at boot, and all dividers are computed again
+ * from the actual clocks: the SPI of the LCD, the UART, the PIO of
+ * the RGB LED, and the SDIO interface of the MicroSD card, which is
+ * initialized again with init_disks().
+ *
+ * 300 MHz on RP2350 is not offered, the flash would be clocked too
+ * fast with the divider set up at boot.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/vreg.h"
+#include "hardware/uart.h"
+
+#include "sim.h"
+#include "simdefs.h"
+
+#include "ff.h"
+#include "DEV_Config.h"
+#include "disks.h"
+#include "rgbled.h"
+#include "sysclk.h"
+
+#define MHZ	1000000
+
+static const struct sysclk {
+	int mhz;			/* clk_sys in MHz */
+	enum vreg_voltage vreg;		/* core voltage needed */
+} sysclks[] = {
+#if PICO_RP2040
+	{ 125, VREG_VOLTAGE_DEFAULT },
+	{ 200, VREG_VOLTAGE_1_15 },
+	{ 250, VREG_VOLTAGE_1_20 }
+#else
+	{ 150, VREG_VOLTAGE_DEFAULT },
+	{ 200, VREG_VOLTAGE_DEFAULT },
+	{ 250, VREG_VOLTAGE_1_20 }
+#endif
+};
+#define NUMCLK (sizeof(sysclks) / sizeof(sysclks[0]))
+
+static enum vreg_voltage vreg = VREG_VOLTAGE_DEFAULT; /* actual voltage */
+
+/*
+ *	actual system clock in MHz
+ */
+int sysclk_mhz(void)
+{
+	return (int) ((clock_get_hz(clk_sys) + MHZ / 2) / MHZ);
+}
+
+/*
+ *	system clock following mhz in the table, for the
+ *	configuration dialog
+ */
+int sysclk_next(int mhz)
+{
+	register unsigned int i;
+
+	for (i = 0; i < NUMCLK - 1; i++)
+		if (sysclks[i].mhz == mhz)
+			return sysclks[i + 1].mhz;
+	return sysclks[0].mhz;
+}
+
+/*
+ *	set the system clock to mhz and the peripherals to it,
+ *	the MicroSD is mounted again, so files open on it are invalid
+ *	afterwards and must not be used anymore
+ */
+bool sysclk_set(int mhz)
+{
+	const struct sysclk *c = NULL;
+	register unsigned int i;
+	uint32_t hz;
+
+	for (i = 0; i < NUMCLK; i++)
+		if (sysclks[i].mhz == mhz)
+			c = &sysclks[i];
+	if (c == NULL) {
+		printf("System clock %d MHz not supported\n", mhz);
+		return false;
+	}
+	if (mhz == sysclk_mhz())
+		return true;
+
+	/* nothing may use the clocks while they change */
+	exit_disks();
+	fflush(stdout);
+#if LIB_PICO_STDIO_UART
+	uart_tx_wait_blocking(uart_default);
+#endif
+
+	if (c->vreg > vreg) {
+		vreg_set_voltage(c->vreg);
+		sleep_ms(10);		/* until the voltage is stable */
+		vreg = c->vreg;
+	}
+	hz = (uint32_t) mhz * MHZ;
+	if (!set_sys_clock_khz(hz / 1000, false))
+		hz = clock_get_hz(clk_sys);
+	clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
+			hz, hz);
+	if (c->vreg < vreg && hz == (uint32_t) mhz * MHZ) {
+		vreg_set_voltage(c->vreg);
+		vreg = c->vreg;
+	}
+
+#if LIB_PICO_STDIO_UART
+	uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+	spi_set_baudrate(SPI_PORT, LCD_SPI_BAUD);
+	pio_sm_set_clkdiv(pio, sm, (float) hz / (WS2812_FREQ *
+			  (ws2812_T1 + ws2812_T2 + ws2812_T3)));
+	init_disks();		/* SDIO clock from the new clk_sys */
+
+	if (hz != (uint32_t) mhz * MHZ) {
+		printf("Can't set system clock to %d MHz\n", mhz);
+		return false;
+	}
+	return true;
+}
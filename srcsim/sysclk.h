@@ -0,0 +1,20 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * Selectable system clock, the clocks of the peripherals are
+ * derived from the actual system clock.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef SYSCLK_INC
+#define SYSCLK_INC
+
+extern int sysclk_mhz(void);
+extern int sysclk_next(int mhz);
+extern bool sysclk_set(int mhz);
+
+#endif /* !SYSCLK_INC */
@@ -0,0 +1,166 @@
+/*
+ * Emulation of Processor Technology VDM-1 on the Pico-Eval-Board LCD
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * The VDM-1 shows 16 lines of 64 characters from 1 KB of memory at
+ * vdm_addr, CC00H unless configured otherwise. Characters with bit 7
+ * set are shown inverse, control characters as blanks. The lower
+ * nibble of the control port selects the line of the memory shown at
+ * the top of the screen, the upper nibble the number of lines blanked
+ * from the top of the screen.
+ *
+ * The LCD shows the VDM-1 from the first output to the control port,
+ * unless the Dazzler is switched on. The LCD task compares the memory
+ * with the characters drawn and draws only the lines which changed,
+ * from the glyphs of Font12 prepared once as bit masks.
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "pico.h"
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+
+#include "vdm.h"
+#include "dazzler.h"
+#include "DEV_Config.h"
+#include "LCD_Driver.h"
+#include "LCD_GUI.h"
+#include "fonts.h"
+
+#define COLS	64
+#define ROWS	16
+#define GLYPH_W	7		/* Font12 */
+#define GLYPH_H	12
+#define ROW_H	20		/* 16 lines fill the 320 pixels of the LCD */
+#define XOFF	((480 - COLS * GLYPH_W) / 2)
+#define YOFF	((ROW_H - GLYPH_H) / 2)
+
+WORD vdm_addr = VDM_ADDR;
+int vdm_state;
+static BYTE vdm_ctl;
+static volatile bool vdm_redraw; /* LCD shows something else */
+
+static BYTE shadow[ROWS][COLS];		/* characters drawn on the LCD */
+static uint8_t glyphs[128][GLYPH_H];	/* glyph lines, left pixel bit 7 */
+static bool glyphs_ok;
+static uint8_t nibble[16][8];		/* 4 pixels in 565 big endian */
+static uint8_t line[COLS * GLYPH_W * 2]; /* one pixel line of a row */
+
+static void init_glyphs(void)
+{
+	int c, y, i;
+	uint16_t color;
+
+	for (c = 0; c < 128; c++)
+		for (y = 0; y < GLYPH_H; y++)
+			glyphs[c][y] = (c >= ' ' && c < 0x7f) ?
+				Font12.table[(c - ' ') * GLYPH_H + y] : 0;
+
+	for (c = 0; c < 16; c++)
+		for (i = 0; i < 4; i++) {
+			color = (c & (8 >> i)) ? WHITE : BLACK;
+			nibble[c][i * 2] = color >> 8;
+			nibble[c][i * 2 + 1] = color & 0xff;
+		}
+
+	glyphs_ok = true;
+}
+
+/* draw one row of characters */
+static void __not_in_flash_func(draw_row)(int r, const BYTE *s)
+{
+	int x, y;
+	uint8_t m, *p;
+	POINT ys = r * ROW_H + YOFF;
+
+	LCD_SetWindow(XOFF, ys, XOFF + COLS * GLYPH_W, ys + GLYPH_H);
+	DEV_Digital_Write(LCD_DC_PIN, 1);
+	DEV_Digital_Write(LCD_CS_PIN, 0);
+	for (y = 0; y < GLYPH_H; y++) {
+		p = line;
+		for (x = 0; x < COLS; x++) {
+			m = glyphs[s[x] & 0x7f][y];
+			if (s[x] & 0x80)
+				m ^= 0xfe;
+			memcpy(p, nibble[m >> 4], 8);
+			memcpy(p + 8, nibble[m & 0x0f], 6);
+			p += GLYPH_W * 2;
+		}
+		spi_write_blocking(SPI_PORT, line, sizeof(line));
+	}
+	DEV_Digital_Write(LCD_CS_PIN, 1);
+}
+
+/* draw the rows changed since the last call */
+void __not_in_flash_func(vdm_draw)(void)
+{
+	BYTE s[COLS];
+	BYTE ctl = vdm_ctl;
+	WORD addr;
+	int r, x;
+	bool all = false;
+
+	if (!glyphs_ok)
+		init_glyphs();
+	if (first_flag || vdm_redraw) {
+		GUI_Clear(BLACK);
+		first_flag = false;
+		vdm_redraw = false;
+		all = true;
+	}
+
+	for (r = 0; r < ROWS; r++) {
+		if (r < (ctl >> 4))
+			memset(s, ' ', COLS);
+		else {
+			addr = vdm_addr + ((r + ctl) & (ROWS - 1)) * COLS;
+			for (x = 0; x < COLS; x++)
+				s[x] = dma_read(addr + x);
+		}
+		if (all || memcmp(s, shadow[r], COLS) != 0) {
+			draw_row(r, s);
+			memcpy(shadow[r], s, COLS);
+		}
+	}
+}
+
+void vdm_ctl_out(BYTE data)
+{
+	vdm_ctl = data;
+
+	/* the LCD shows the VDM-1 from now on */
+	if (vdm_state == 0) {
+		vdm_redraw = true;
+		vdm_state = 1;
+		if (!dazzler_state)
+			first_flag = true;
+	}
+}
+
+/*
+ * state of the VDM-1 for the snapshot
+ */
+void vdm_get_state(int *state, BYTE *ctl)
+{
+	*state = vdm_state;
+	*ctl = vdm_ctl;
+}
+
+void vdm_set_state(int state, BYTE ctl)
+{
+	vdm_ctl = ctl;
+	if (vdm_state != state) {
+		vdm_redraw = true;
+		vdm_state = state;
+		if (!dazzler_state)
+			first_flag = true;
+	}
+}
@@ -0,0 +1,25 @@
+/*
+ * Emulation of Processor Technology VDM-1 on the Pico-Eval-Board LCD
+ *
+ * Copyright (C) 2024 by Udo Munk & Thomas Eberhardt
+ *
+ * History:
+ * 19-OCT-2026 first version
+ */
+
+#ifndef VDM_INC
+#define VDM_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define VDM_ADDR 0xcc00		/* default address of the display memory */
+
+extern void vdm_ctl_out(BYTE data);
+extern void vdm_draw(void);
+extern void vdm_get_state(int *state, BYTE *ctl);
+extern void vdm_set_state(int state, BYTE ctl);
+extern WORD vdm_addr;
+extern int vdm_state;
+
+#endif /* !VDM_INC */